@@ -1,18 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <utility>
+#include <vector>
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/name.hpp>
 #include <eosio/multi_index.hpp>
+#include <eosio/singleton.hpp>
+#include <eosio/crypto.hpp>
 #include <eosio/fixed_bytes.hpp>
 
-namespace horuspay {
+#include "payment.hpp"
 
-static uint128_t compute_key(uint64_t user, uint64_t project) {
-   return ((uint128_t(user) << 64) | uint128_t(project));
-}
+namespace horuspay {
 
 using std::string;
 using std::optional;
@@ -20,18 +23,19 @@ using eosio::name;
 using eosio::asset;
 using eosio::extended_asset;
 using eosio::multi_index;
-using eosio::indexed_by;
-using eosio::const_mem_fun;
 using eosio::fixed_bytes;
 using eosio::block_timestamp;
 using eosio::same_payer;
+using eosio::public_key;
+using eosio::signature;
+using eosio::checksum256;
 
 class [[eosio::contract]] horuspay : public eosio::contract {
    public:
       using contract::contract;
 
    struct [[eosio::table]] project {
-      name           name;
+      eosio::name    name;
       extended_asset hourly_rate;
       extended_asset balance;
 
@@ -44,7 +48,42 @@ class [[eosio::contract]] horuspay : public eosio::contract {
    typedef multi_index< "project"_n, project >  project_table;
 
 
+   // scope: project
+   // rate is in units of the project hourly_rate asset (same symbol and contract)
+   // carry is the unpaid fraction of the last payment, in sub-unit seconds
    struct [[eosio::table]] project_user {
+      name                     user;
+      int64_t                  pending;
+      int64_t                  rate;
+      int16_t                  carry;
+      block_timestamp          last_clock;
+
+      uint64_t primary_key() const {
+         return user.value;
+      }
+
+      EOSLIB_SERIALIZE( project_user, (user)(pending)(rate)(carry)(last_clock))
+   };
+   typedef eosio::multi_index< "projectuser"_n, project_user >  project_user_table;
+
+
+   // scope: project
+   struct [[eosio::table]] project_manager {
+      name     manager;
+      bool     is_owner;
+
+      uint64_t primary_key() const {
+         return manager.value;
+      }
+
+      EOSLIB_SERIALIZE( project_manager, (manager)(is_owner))
+   };
+   typedef multi_index< "projectmgr"_n, project_manager >  project_manager_table;
+
+
+   // scope: _self
+   // membership rows written before the tables were scoped by project, only read by migrate
+   struct legacy_project_user {
       uint64_t                 id;
       name                     project;
       name                     user;
@@ -57,17 +96,16 @@ class [[eosio::contract]] horuspay : public eosio::contract {
       }
 
       uint128_t by_project_user() const {
-         return compute_key(user.value, project.value);
+         return (uint128_t(user.value) << 64) | project.value;
       }
 
-      EOSLIB_SERIALIZE( project_user, (id)(project)(user)(pending)(hourly_rate)(last_clock))
+      EOSLIB_SERIALIZE( legacy_project_user, (id)(project)(user)(pending)(hourly_rate)(last_clock))
    };
-   typedef eosio::multi_index< "projectuser"_n, project_user,
-            eosio::indexed_by<"byusr"_n, const_mem_fun<project_user, uint128_t, &project_user::by_project_user>>
-            >  project_user_table;
-
+   typedef multi_index< "projectuser"_n, legacy_project_user,
+      eosio::indexed_by< "byusr"_n, eosio::const_mem_fun<legacy_project_user, uint128_t, &legacy_project_user::by_project_user> >
+   > legacy_project_user_table;
 
-   struct [[eosio::table]] project_manager {
+   struct legacy_project_manager {
       uint64_t id;
       name     project;
       name     manager;
@@ -78,19 +116,251 @@ class [[eosio::contract]] horuspay : public eosio::contract {
       }
 
       uint128_t by_project_manager() const {
-         return compute_key(manager.value, project.value);
-      } 
+         return (uint128_t(manager.value) << 64) | project.value;
+      }
+
+      EOSLIB_SERIALIZE( legacy_project_manager, (id)(project)(manager)(is_owner))
+   };
+   typedef multi_index< "projectmgr"_n, legacy_project_manager,
+      eosio::indexed_by< "bymgr"_n, eosio::const_mem_fun<legacy_project_manager, uint128_t, &legacy_project_manager::by_project_manager> >
+   > legacy_project_manager_table;
+
+
+   // scope: user
+   // balance owed to the user, paid out by withdraw
+   struct [[eosio::table]] account {
+      asset    balance;
+      name     contract;
+
+      uint64_t primary_key() const {
+         return balance.symbol.code().raw();
+      }
+
+      EOSLIB_SERIALIZE( account, (balance)(contract))
+   };
+   typedef multi_index< "accounts"_n, account >  account_table;
+
+
+   // scope: _self
+   // token contracts whose transfers are accepted as project deposits
+   struct [[eosio::table]] allowed_token {
+      name     contract;
+
+      uint64_t primary_key() const {
+         return contract.value;
+      }
+
+      EOSLIB_SERIALIZE( allowed_token, (contract))
+   };
+   typedef multi_index< "tokens"_n, allowed_token >  allowed_token_table;
 
-      EOSLIB_SERIALIZE( project_manager, (id)(project)(manager)(is_owner))
+
+   // scope: _self
+   // token contract each symbol is paid from; user balances are kept per symbol code, so one
+   // code can't be paid from two contracts
+   struct [[eosio::table]] pay_symbol {
+      eosio::symbol  symbol;
+      name           contract;
+
+      uint64_t primary_key() const {
+         return symbol.code().raw();
+      }
+
+      EOSLIB_SERIALIZE( pay_symbol, (symbol)(contract))
    };
-   typedef multi_index< "projectmgr"_n, project_manager,
-            indexed_by<"bymgr"_n, const_mem_fun<project_manager, uint128_t, &project_manager::by_project_manager>>
-         >  project_manager_table;
+   typedef multi_index< "symbols"_n, pay_symbol >  pay_symbol_table;
+
+
+   // scope: _self
+   // running totals of a project, updated incrementally by every action that changes its rows
+   // liability is what the pending seconds of all members would pay if approved now
+   struct [[eosio::table]] project_stats {
+      name     project;
+      int64_t  pending;
+      uint32_t members;
+      uint32_t managers;
+      uint32_t clocked_in;
+      asset    liability;
+
+      uint64_t primary_key() const {
+         return project.value;
+      }
+
+      EOSLIB_SERIALIZE( project_stats, (project)(pending)(members)(managers)(clocked_in)(liability))
+   };
+   typedef multi_index< "projstats"_n, project_stats >  project_stats_table;
+
+
+   // scope: _self
+   // key users sign timesheets with, nonce is the highest timesheet nonce already applied
+   struct [[eosio::table]] user_key {
+      name        user;
+      public_key  key;
+      uint64_t    nonce;
+
+      uint64_t primary_key() const {
+         return user.value;
+      }
+
+      EOSLIB_SERIALIZE( user_key, (user)(key)(nonce))
+   };
+   typedef multi_index< "userkeys"_n, user_key >  user_key_table;
+
+
+   // scope: _self
+   // event_sink enables logevent: empty disables it, _self only logs it in the action traces,
+   // any other account is also notified
+   struct [[eosio::table]] config {
+      name     event_sink;
+
+      EOSLIB_SERIALIZE( config, (event_sink))
+   };
+   typedef eosio::singleton< "config"_n, config >  config_singleton;
+
+
+   // scope: project
+   // one row per recorded time entry, approveentry/declineentry settle it, approve, batchapprove,
+   // runpayroll and decline settle the oldest pending entries of the user, and compact folds old
+   // settled rows into rollups
+   enum entry_status : uint8_t {
+      entry_pending  = 0,
+      entry_approved = 1,
+      entry_declined = 2
+   };
+
+   struct [[eosio::table]] ledger_entry {
+      uint64_t          id;
+      name              user;
+      uint64_t          seconds;
+      block_timestamp   start;
+      uint8_t           status;
+
+      uint64_t primary_key() const {
+         return id;
+      }
+
+      uint128_t by_status() const {
+         return status == entry_pending ? pending_entry_key(user, id) : settled_entry_key(start, id);
+      }
+
+      EOSLIB_SERIALIZE( ledger_entry, (id)(user)(seconds)(start)(status))
+   };
+   typedef multi_index< "entries"_n, ledger_entry,
+      eosio::indexed_by< "bystatus"_n, eosio::const_mem_fun<ledger_entry, uint128_t, &ledger_entry::by_status> >
+   > ledger_entry_table;
+
+   // pending entries sort by user then id below 2^127, settled entries by start then id above it
+   static uint128_t pending_entry_key(name user, uint64_t id) {
+      return (uint128_t(user.value) << 63) | id;
+   }
+
+   static uint128_t settled_entry_key(block_timestamp start, uint64_t id) {
+      return (uint128_t(1) << 127) | (uint128_t(start.slot) << 64) | id;
+   }
+
+
+   // scope: project
+   // next entry id, kept apart from the entries table so ids are never reused after compaction
+   struct [[eosio::table]] ledger_state {
+      uint64_t next_id;
+
+      EOSLIB_SERIALIZE( ledger_state, (next_id))
+   };
+   typedef eosio::singleton< "ledger"_n, ledger_state >  ledger_state_singleton;
+
+
+   // scope: project
+   // settled seconds of a user in one period (week of the entry start, see week_of)
+   struct [[eosio::table]] entry_rollup {
+      uint64_t   id;
+      name       user;
+      uint32_t   period;
+      uint64_t   approved;
+      uint64_t   declined;
+      uint32_t   entries;
+
+      uint64_t primary_key() const {
+         return id;
+      }
+
+      uint128_t by_user_period() const {
+         return user_period_key(user, period);
+      }
+
+      EOSLIB_SERIALIZE( entry_rollup, (id)(user)(period)(approved)(declined)(entries))
+   };
+   typedef multi_index< "rollups"_n, entry_rollup,
+      eosio::indexed_by< "byuserperiod"_n, eosio::const_mem_fun<entry_rollup, uint128_t, &entry_rollup::by_user_period> >
+   > entry_rollup_table;
+
+   static uint128_t user_period_key(name user, uint32_t period) {
+      return (uint128_t(user.value) << 64) | period;
+   }
+
+   // weeks start on Monday 00:00 UTC and are counted from Monday 1969-12-29, three days before
+   // the epoch (a Thursday)
+   static uint32_t week_of(uint32_t sec_since_epoch) {
+      return (uint64_t(sec_since_epoch) + 3 * 86400) / (7 * 86400);
+   }
+
+
+   // scope: project
+   // Merkle root of every entry of a pay period, the entries themselves stay off-chain
+   // disputes counts the entries proven to belong to the period with dispute, disputed holds
+   // their indexes in ascending order so each entry is counted once
+   struct [[eosio::table]] period_commit {
+      uint32_t                period;
+      checksum256             root;
+      uint32_t                entries;
+      int64_t                 seconds;
+      name                    manager;
+      uint32_t                disputes;
+      std::vector<uint32_t>   disputed;
+
+      uint64_t primary_key() const {
+         return period;
+      }
+
+      EOSLIB_SERIALIZE( period_commit, (period)(root)(entries)(seconds)(manager)(disputes)(disputed))
+   };
+   typedef multi_index< "periods"_n, period_commit >  period_commit_table;
+
+
+   // scope: project
+   // next user to visit by runpayroll, the row only exists while a run is in progress
+   struct [[eosio::table]] payroll_cursor {
+      name     next_user;
+
+      EOSLIB_SERIALIZE( payroll_cursor, (next_user))
+   };
+   typedef eosio::singleton< "payrollcur"_n, payroll_cursor >  payroll_cursor_singleton;
 
 
       [[eosio::action]]
       void create(name project, name owner, extended_asset hourly_rate);
 
+      [[eosio::action]]
+      void addtoken(name contract);
+
+      [[eosio::action]]
+      void rmvtoken(name contract);
+
+      [[eosio::action]]
+      void setsink(name sink);
+
+      // moves up to max_rows legacy projectuser/projectmgr rows from scope _self to the scope of
+      // their project, managers first; the stats of a moved project are counted again
+      [[eosio::action]]
+      void migrate(uint32_t max_rows);
+
+      // inline only, one per user row change: seconds is the change of pending (negative when
+      // approved or declined), pending the new value and amount the payment in units of the
+      // project token (deposited or withdrawn quantity, or the new rate for create/adduser/setuserrate).
+      // Project changes without a user row log the owner (create), manager (addmanager, rmvmanager,
+      // compact with amount the entries folded) or entry user (dispute with amount the period)
+      [[eosio::action]]
+      void logevent(name event, name project, name user, int64_t seconds, int64_t amount, int64_t pending);
+
       [[eosio::action]]
       void adduser(name project, name manager, name user);
 
@@ -109,12 +379,99 @@ class [[eosio::contract]] horuspay : public eosio::contract {
       [[eosio::action]]
       void clockout(name project, name user, optional<string> description);
 
+      // closes the session of user on `from` and opens one on `to` at the same block time
+      [[eosio::action]]
+      void switchclock(name from, name to, name user, optional<string> description);
+
       [[eosio::action]]
       void addtime(name project, name user, uint64_t seconds, optional<string> description, optional<name> manager);
 
+      struct time_entry {
+         name             user;
+         uint64_t         seconds;
+         optional<string> description;
+
+         EOSLIB_SERIALIZE( time_entry, (user)(seconds)(description))
+      };
+
+      [[eosio::action]]
+      void addtimes(name project, name manager, std::vector<time_entry> entries);
+
+      [[eosio::action]]
+      void setkey(name user, public_key key);
+
+      // signed off-chain by the user: sha256 of the packed contract account followed by the timesheet
+      // period is a label chosen by the project (e.g. the week) and is only covered by the signature
+      struct timesheet {
+         name       project;
+         name       user;
+         uint64_t   seconds;
+         uint32_t   period;
+         uint64_t   nonce;
+
+         EOSLIB_SERIALIZE( timesheet, (project)(user)(seconds)(period)(nonce))
+      };
+
+      struct signed_timesheet {
+         timesheet  sheet;
+         signature  sig;
+
+         EOSLIB_SERIALIZE( signed_timesheet, (sheet)(sig))
+      };
+
+      [[eosio::action]]
+      void addsigned(name project, name manager, std::vector<signed_timesheet> sheets);
+
+      [[eosio::action]]
+      void approveentry(name project, name manager, std::vector<uint64_t> ids);
+
+      [[eosio::action]]
+      void declineentry(name project, name manager, std::vector<uint64_t> ids);
+
+      [[eosio::action]]
+      void compact(name project, name manager, uint32_t days, uint32_t max_rows);
+
+      // leaf of a period tree: sha256 of 0x00 followed by the packed entry
+      struct period_entry {
+         name       user;
+         uint64_t   seconds;
+         string     description;
+
+         EOSLIB_SERIALIZE( period_entry, (user)(seconds)(description))
+      };
+
+      struct period_total {
+         name       user;
+         uint64_t   seconds;
+
+         EOSLIB_SERIALIZE( period_total, (user)(seconds))
+      };
+
+      [[eosio::action]]
+      void commitperiod(name project, name manager, uint32_t period, checksum256 root, uint32_t entries, std::vector<period_total> totals);
+
+      [[eosio::action]]
+      void dispute(name project, uint32_t period, name disputer, period_entry entry, uint32_t index, std::vector<checksum256> proof);
+
       [[eosio::action]]
       void approve(name project, name manager, name user, optional<int64_t> seconds);
 
+      struct approval {
+         name              user;
+         optional<int64_t> seconds;
+
+         EOSLIB_SERIALIZE( approval, (user)(seconds))
+      };
+
+      [[eosio::action]]
+      void batchapprove(name project, name manager, std::vector<approval> approvals);
+
+      [[eosio::action]]
+      void runpayroll(name project, name manager, uint32_t max_rows);
+
+      [[eosio::action]]
+      void withdraw(name user, asset quantity);
+
       [[eosio::action]]
       void decline(name project, name manager, name user, int64_t seconds);
 
@@ -138,7 +495,45 @@ class [[eosio::contract]] horuspay : public eosio::contract {
       };
 
       using transfer_action = eosio::action_wrapper<"transfer"_n, &token::transfer>;
+      using logevent_action = eosio::action_wrapper<"logevent"_n, &horuspay::logevent>;
       static constexpr eosio::name active_permission{"active"_n};
+
+   private:
+      static constexpr rounding pay_rounding = rounding::down;
+
+      void credit(name user, const extended_asset& amount);
+
+      static bool is_project_memo(const std::string& memo);
+
+      // read once per action and passed to every log_event of the action
+      name event_sink();
+      void log_event(name sink, name event, name project, name user, int64_t seconds, int64_t amount, int64_t pending);
+
+      void append_entries(name project, block_timestamp start, const std::vector<std::pair<name, uint64_t>>& entries);
+
+      void settle_entries(name project, name user, uint64_t seconds, entry_status status);
+
+      static checksum256 merkle_leaf(const period_entry& entry);
+      static checksum256 merkle_node(const checksum256& left, const checksum256& right);
+
+      static int64_t owed(const project_user& pu) {
+         return compute_payment(pu.rate, pu.pending, pu.carry, pay_rounding).amount;
+      }
+
+      void rebuild_stats(name project);
+
+      // callers apply their table changes first: a project created before the stats table has no
+      // row, and gets one counted from its current members and managers instead of the update
+      template<typename Lambda>
+      void update_stats(name project, Lambda&& updater) {
+         project_stats_table _stats(_self, _self.value);
+         auto st = _stats.find(project.value);
+         if(st == _stats.end()) {
+            rebuild_stats(project);
+            return;
+         }
+         _stats.modify(st, same_payer, std::forward<Lambda&&>(updater));
+      }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include <eosio/check.hpp>
+
+namespace horuspay {
+
+enum class rounding : uint8_t {
+   down,    // floor, remainder carried is in [0, 3600)
+   nearest, // half up, remainder carried is in [-1800, 1800)
+   up       // ceiling, remainder carried is in (-3600, 0]
+};
+
+struct payment {
+   int64_t amount;    // token sub-units to pay now
+   int64_t remainder; // sub-unit seconds owed (or overpaid if negative) after this payment
+};
+
+static constexpr int64_t seconds_per_hour = 3600;
+
+/**
+ * Computes the pay for `seconds` of work at `rate` token sub-units per hour
+ * using integer arithmetic only.
+ *
+ * `carry` is the remainder returned by the previous payment to the same user,
+ * so approving hours in many small pieces pays exactly the same total as
+ * approving them at once. `rate * seconds` is evaluated in 128 bits and the
+ * amount must fit in 64 bits again.
+ */
+inline payment compute_payment(int64_t rate, int64_t seconds, int64_t carry, rounding mode = rounding::down) {
+   __int128 total = __int128(rate) * __int128(seconds) + carry;
+
+   __int128 amount    = total / seconds_per_hour;
+   __int128 remainder = total % seconds_per_hour;
+   if(remainder < 0) {
+      amount    -= 1;
+      remainder += seconds_per_hour;
+   }
+
+   switch(mode) {
+      case rounding::down:
+         break;
+      case rounding::nearest:
+         if(2 * remainder >= seconds_per_hour) {
+            amount    += 1;
+            remainder -= seconds_per_hour;
+         }
+         break;
+      case rounding::up:
+         if(remainder > 0) {
+            amount    += 1;
+            remainder -= seconds_per_hour;
+         }
+         break;
+   }
+
+   eosio::check(amount >= std::numeric_limits<int64_t>::min() && amount <= std::numeric_limits<int64_t>::max(),
+                "payment amount out of range");
+
+   return payment{ int64_t(amount), int64_t(remainder) };
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/serialize.hpp>
+#include <eosio/native/host.hpp>
+
+namespace eosio {
+
+   struct permission_level {
+      permission_level( name a, name p ) : actor(a), permission(p) {}
+      permission_level() {}
+
+      name actor;
+      name permission;
+
+      friend constexpr bool operator == ( const permission_level& a, const permission_level& b ) {
+         return std::tie( a.actor, a.permission ) == std::tie( b.actor, b.permission );
+      }
+
+      EOSLIB_SERIALIZE( permission_level, (actor)(permission) )
+   };
+
+   bool has_auth( name n );
+
+   void require_auth( name n );
+
+   void require_auth( const permission_level& level );
+
+   bool is_account( name n );
+
+   void require_recipient( name notify_account );
+
+   template<typename... accounts>
+   void require_recipient( name notify_account, accounts... remaining_accounts ) {
+      require_recipient( notify_account );
+      require_recipient( remaining_accounts... );
+   }
+
+   struct action {
+      eosio::name                   account;
+      eosio::name                   name;
+      std::vector<permission_level> authorization;
+      std::vector<char>             data;
+
+      action() = default;
+
+      template<typename T>
+      action( const std::vector<permission_level>& auth, struct name a, struct name n, T&& value )
+      :account(a), name(n), authorization(auth), data(pack(std::forward<T>(value))) {}
+
+      template<typename T>
+      action( const permission_level& auth, struct name a, struct name n, T&& value )
+      :account(a), name(n), authorization(1,auth), data(pack(std::forward<T>(value))) {}
+
+      /// Queues the action; the native driver executes it after the current one
+      void send()const {
+         native::host::instance().inline_actions().push_back( *this );
+      }
+
+      template<typename T>
+      T data_as()const {
+         return unpack<T>( data );
+      }
+
+      EOSLIB_SERIALIZE( action, (account)(name)(authorization)(data) )
+   };
+
+   namespace detail {
+      template<typename T>
+      struct member_function_args;
+
+      template<typename C, typename R, typename... Args>
+      struct member_function_args<R (C::*)(Args...)> {
+         using type = std::tuple<std::decay_t<Args>...>;
+      };
+
+      template<typename C, typename R, typename... Args>
+      struct member_function_args<R (C::*)(Args...) const> {
+         using type = std::tuple<std::decay_t<Args>...>;
+      };
+   }
+
+   template<name::raw Name, auto Action>
+   struct action_wrapper {
+      template<typename Code>
+      constexpr action_wrapper( Code&& code, std::vector<permission_level>&& perms )
+         : code_name(std::forward<Code>(code)), permissions(std::move(perms)) {}
+
+      template<typename Code>
+      constexpr action_wrapper( Code&& code, const std::vector<permission_level>& perms )
+         : code_name(std::forward<Code>(code)), permissions(perms) {}
+
+      template<typename Code>
+      constexpr action_wrapper( Code&& code, permission_level&& perm )
+         : code_name(std::forward<Code>(code)), permissions({1, std::move(perm)}) {}
+
+      template<typename Code>
+      constexpr action_wrapper( Code&& code, const permission_level& perm )
+         : code_name(std::forward<Code>(code)), permissions({1, perm}) {}
+
+      static constexpr eosio::name action_name = eosio::name(Name);
+      eosio::name code_name;
+      std::vector<permission_level> permissions;
+
+      template<typename... Args>
+      action to_action( Args&&... args )const {
+         using args_type = typename detail::member_function_args<decltype(Action)>::type;
+         return action( permissions, code_name, action_name, args_type( std::forward<Args>(args)... ) );
+      }
+
+      template<typename... Args>
+      void send( Args&&... args )const {
+         to_action( std::forward<Args>(args)... ).send();
+      }
+   };
+
+} // namespace eosio
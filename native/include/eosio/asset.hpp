@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+
+namespace eosio {
+
+   struct asset {
+      int64_t amount = 0;
+      eosio::symbol symbol;
+
+      static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+      asset() {}
+      asset( int64_t a, class symbol s ) : amount(a), symbol{s} {
+         check( is_amount_within_range(), "magnitude of asset amount must be less than 2^62" );
+         check( symbol.is_valid(), "invalid symbol name" );
+      }
+
+      bool is_amount_within_range()const { return -max_amount <= amount && amount <= max_amount; }
+      bool is_valid()const { return is_amount_within_range() && symbol.is_valid(); }
+
+      asset operator-()const {
+         asset r = *this;
+         r.amount = -r.amount;
+         return r;
+      }
+
+      asset& operator-=( const asset& a ) {
+         check( a.symbol == symbol, "attempt to subtract asset with different symbol" );
+         amount -= a.amount;
+         check( -max_amount <= amount, "subtraction underflow" );
+         check( amount <= max_amount,  "subtraction overflow" );
+         return *this;
+      }
+
+      asset& operator+=( const asset& a ) {
+         check( a.symbol == symbol, "attempt to add asset with different symbol" );
+         amount += a.amount;
+         check( -max_amount <= amount, "addition underflow" );
+         check( amount <= max_amount,  "addition overflow" );
+         return *this;
+      }
+
+      friend asset operator+( const asset& a, const asset& b ) {
+         asset result = a;
+         result += b;
+         return result;
+      }
+
+      friend asset operator-( const asset& a, const asset& b ) {
+         asset result = a;
+         result -= b;
+         return result;
+      }
+
+      friend bool operator==( const asset& a, const asset& b ) {
+         check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount == b.amount;
+      }
+
+      friend bool operator!=( const asset& a, const asset& b ) {
+         return !( a == b );
+      }
+
+      friend bool operator<( const asset& a, const asset& b ) {
+         check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount < b.amount;
+      }
+
+      friend bool operator<=( const asset& a, const asset& b ) {
+         check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount <= b.amount;
+      }
+
+      friend bool operator>( const asset& a, const asset& b ) {
+         check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount > b.amount;
+      }
+
+      friend bool operator>=( const asset& a, const asset& b ) {
+         check( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount >= b.amount;
+      }
+
+      std::string to_string()const {
+         bool negative = amount < 0;
+         uint64_t abs_amount = negative ? -uint64_t(amount) : uint64_t(amount);
+         uint8_t precision = symbol.precision();
+
+         uint64_t p10 = 1;
+         for( uint8_t i = 0; i < precision; ++i ) p10 *= 10;
+
+         std::string result = negative ? "-" : "";
+         result += std::to_string( abs_amount / p10 );
+         if( precision > 0 ) {
+            std::string fraction = std::to_string( abs_amount % p10 );
+            result += "." + std::string( precision - fraction.size(), '0' ) + fraction;
+         }
+         return result + " " + symbol.code().to_string();
+      }
+
+      EOSLIB_SERIALIZE( asset, (amount)(symbol) )
+   };
+
+   struct extended_asset {
+      asset quantity;
+      name  contract;
+
+      extended_asset() = default;
+      extended_asset( asset a, name c ) : quantity(a), contract(c) {}
+
+      extended_asset& operator-=( const extended_asset& a ) {
+         check( a.contract == contract, "type mismatch" );
+         quantity -= a.quantity;
+         return *this;
+      }
+
+      extended_asset& operator+=( const extended_asset& a ) {
+         check( a.contract == contract, "type mismatch" );
+         quantity += a.quantity;
+         return *this;
+      }
+
+      friend bool operator==( const extended_asset& a, const extended_asset& b ) {
+         return std::tie(a.quantity.amount, a.contract) == std::tie(b.quantity.amount, b.contract) &&
+                a.quantity.symbol == b.quantity.symbol;
+      }
+
+      friend bool operator!=( const extended_asset& a, const extended_asset& b ) {
+         return !( a == b );
+      }
+
+      EOSLIB_SERIALIZE( extended_asset, (quantity)(contract) )
+   };
+
+} // namespace eosio
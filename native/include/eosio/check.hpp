@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+   /**
+    * Thrown by `check` when an assertion fails; the message matches the one
+    * nodeos reports as "assertion failure with message: <msg>".
+    */
+   struct assert_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   inline void check( bool pred, const char* msg ) {
+      if( !pred ) throw assert_exception( msg );
+   }
+
+   inline void check( bool pred, const std::string& msg ) {
+      if( !pred ) throw assert_exception( msg );
+   }
+
+} // namespace eosio
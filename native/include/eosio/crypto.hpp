@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/serialize.hpp>
+#include <eosio/varint.hpp>
+
+namespace eosio {
+
+   struct public_key {
+      unsigned_int        type;
+      std::array<char,33> data;
+
+      friend bool operator == ( const public_key& a, const public_key& b ) {
+         return a.type == b.type && a.data == b.data;
+      }
+      friend bool operator != ( const public_key& a, const public_key& b ) {
+         return !( a == b );
+      }
+
+      EOSLIB_SERIALIZE( public_key, (type)(data) )
+   };
+
+   struct signature {
+      unsigned_int        type;
+      std::array<char,65> data;
+
+      friend bool operator == ( const signature& a, const signature& b ) {
+         return a.type == b.type && a.data == b.data;
+      }
+      friend bool operator != ( const signature& a, const signature& b ) {
+         return !( a == b );
+      }
+
+      EOSLIB_SERIALIZE( signature, (type)(data) )
+   };
+
+   checksum256 sha256( const char* data, uint32_t length );
+
+   void assert_sha256( const char* data, uint32_t length, const checksum256& hash );
+
+   /**
+    * Natively there is no secp256k1; the check is delegated to
+    * native::host::verify_signature (see eosio/native/host.hpp).
+    */
+   void assert_recover_key( const checksum256& digest, const signature& sig, const public_key& pubkey );
+
+} // namespace eosio
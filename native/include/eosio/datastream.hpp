@@ -0,0 +1,262 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/varint.hpp>
+
+namespace eosio {
+
+   /**
+    * Byte stream compatible with the CDT datastream: `datastream<char*>`
+    * writes, `datastream<const char*>` reads and `datastream<size_t>`
+    * measures.
+    */
+   template<typename T>
+   class datastream {
+   public:
+      datastream( T start, size_t s ) : _start(start), _pos(start), _end(start + s) {}
+
+      void skip( size_t s ) { _pos += s; }
+
+      bool read( char* d, size_t s ) {
+         check( size_t(_end - _pos) >= s, "datastream attempted to read past the end" );
+         std::memcpy( d, _pos, s );
+         _pos += s;
+         return true;
+      }
+
+      bool write( const char* d, size_t s ) {
+         check( _end - _pos >= (int32_t)s, "datastream attempted to write past the end" );
+         std::memcpy( (void*)_pos, d, s );
+         _pos += s;
+         return true;
+      }
+
+      bool put( char c ) {
+         check( _pos < _end, "put" );
+         *_pos = c;
+         ++_pos;
+         return true;
+      }
+
+      bool get( char& c ) {
+         check( _pos < _end, "get" );
+         c = *_pos;
+         ++_pos;
+         return true;
+      }
+
+      T pos()const { return _pos; }
+      bool valid()const { return _pos <= _end && _pos >= _start; }
+      size_t tellp()const { return size_t(_pos - _start); }
+      size_t remaining()const { return _end - _pos; }
+
+   private:
+      T _start;
+      T _pos;
+      T _end;
+   };
+
+   template<>
+   class datastream<size_t> {
+   public:
+      datastream( size_t init_size = 0 ) : _size(init_size) {}
+
+      bool skip( size_t s ) { _size += s; return true; }
+      bool write( const char*, size_t s ) { _size += s; return true; }
+      bool put( char ) { ++_size; return true; }
+      bool valid()const { return true; }
+      size_t tellp()const { return _size; }
+      size_t remaining()const { return 0; }
+
+   private:
+      size_t _size;
+   };
+
+   template<typename Stream, typename T, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>* = nullptr>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const T& v ) {
+      ds.write( (const char*)&v, sizeof(T) );
+      return ds;
+   }
+
+   template<typename Stream, typename T, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>* = nullptr>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, T& v ) {
+      ds.read( (char*)&v, sizeof(T) );
+      return ds;
+   }
+
+   template<typename Stream>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const bool& v ) {
+      return ds << uint8_t(v);
+   }
+
+   template<typename Stream>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, bool& v ) {
+      uint8_t t;
+      ds >> t;
+      v = t;
+      return ds;
+   }
+
+   template<typename Stream>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::string& v ) {
+      ds << unsigned_int( v.size() );
+      if( v.size() ) ds.write( v.data(), v.size() );
+      return ds;
+   }
+
+   template<typename Stream>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::string& v ) {
+      std::vector<char> tmp;
+      ds >> tmp;
+      v = std::string( tmp.data(), tmp.size() );
+      return ds;
+   }
+
+   template<typename Stream, typename T>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::vector<T>& v ) {
+      ds << unsigned_int( v.size() );
+      for( const auto& i : v ) ds << i;
+      return ds;
+   }
+
+   template<typename Stream, typename T>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::vector<T>& v ) {
+      unsigned_int s;
+      ds >> s;
+      v.resize( s.value );
+      for( auto& i : v ) ds >> i;
+      return ds;
+   }
+
+   template<typename Stream>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::vector<char>& v ) {
+      ds << unsigned_int( v.size() );
+      ds.write( v.data(), v.size() );
+      return ds;
+   }
+
+   template<typename Stream>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::vector<char>& v ) {
+      unsigned_int s;
+      ds >> s;
+      v.resize( s.value );
+      ds.read( v.data(), v.size() );
+      return ds;
+   }
+
+   template<typename Stream, typename T, size_t N>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::array<T,N>& v ) {
+      for( const auto& i : v ) ds << i;
+      return ds;
+   }
+
+   template<typename Stream, typename T, size_t N>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::array<T,N>& v ) {
+      for( auto& i : v ) ds >> i;
+      return ds;
+   }
+
+   template<typename Stream, typename T>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::optional<T>& opt ) {
+      char valid = opt.has_value();
+      ds << valid;
+      if( valid ) ds << *opt;
+      return ds;
+   }
+
+   template<typename Stream, typename T>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::optional<T>& opt ) {
+      char valid = 0;
+      ds >> valid;
+      if( valid ) {
+         T val;
+         ds >> val;
+         opt = val;
+      } else {
+         opt.reset();
+      }
+      return ds;
+   }
+
+   template<typename Stream, typename T1, typename T2>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::pair<T1,T2>& t ) {
+      return ds << t.first << t.second;
+   }
+
+   template<typename Stream, typename T1, typename T2>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::pair<T1,T2>& t ) {
+      return ds >> t.first >> t.second;
+   }
+
+   template<typename Stream, typename K, typename V>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::map<K,V>& m ) {
+      ds << unsigned_int( m.size() );
+      for( const auto& i : m ) ds << i.first << i.second;
+      return ds;
+   }
+
+   template<typename Stream, typename K, typename V>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::map<K,V>& m ) {
+      m.clear();
+      unsigned_int s;
+      ds >> s;
+      for( uint32_t i = 0; i < s.value; ++i ) {
+         K k; V v;
+         ds >> k >> v;
+         m.emplace( std::move(k), std::move(v) );
+      }
+      return ds;
+   }
+
+   template<typename Stream, typename... Args>
+   datastream<Stream>& operator << ( datastream<Stream>& ds, const std::tuple<Args...>& t ) {
+      std::apply( [&]( const auto&... e ) { ( (ds << e), ... ); }, t );
+      return ds;
+   }
+
+   template<typename Stream, typename... Args>
+   datastream<Stream>& operator >> ( datastream<Stream>& ds, std::tuple<Args...>& t ) {
+      std::apply( [&]( auto&... e ) { ( (ds >> e), ... ); }, t );
+      return ds;
+   }
+
+   template<typename T>
+   size_t pack_size( const T& value ) {
+      datastream<size_t> ps;
+      ps << value;
+      return ps.tellp();
+   }
+
+   template<typename T>
+   std::vector<char> pack( const T& value ) {
+      std::vector<char> result;
+      result.resize( pack_size( value ) );
+      datastream<char*> ds( result.data(), result.size() );
+      ds << value;
+      return result;
+   }
+
+   template<typename T>
+   T unpack( const char* buffer, size_t len ) {
+      T result;
+      datastream<const char*> ds( buffer, len );
+      ds >> result;
+      return result;
+   }
+
+   template<typename T>
+   T unpack( const std::vector<char>& bytes ) {
+      return unpack<T>( bytes.data(), bytes.size() );
+   }
+
+} // namespace eosio
@@ -0,0 +1,491 @@
+#pragma once
+
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/host.hpp>
+
+typedef unsigned __int128 uint128_t;
+
+namespace eosio {
+
+   constexpr static inline name same_payer{};
+
+   template<class Class, typename Type, Type (Class::*PtrToMemberFunction)()const>
+   struct const_mem_fun {
+      typedef typename std::remove_reference<Type>::type result_type;
+
+      Type operator()( const Class& x )const { return (x.*PtrToMemberFunction)(); }
+   };
+
+   template<name::raw IndexName, typename Extractor>
+   struct indexed_by {
+      enum constants { index_name = static_cast<uint64_t>(IndexName) };
+      typedef Extractor secondary_extractor_type;
+   };
+
+namespace native {
+
+   /// One row as stored on chain: (code, scope, table, primary key, packed bytes)
+   struct table_row_dump {
+      name              code;
+      uint64_t          scope;
+      name              table;
+      uint64_t          primary_key;
+      std::vector<char> data;
+   };
+
+   /**
+    * Every multi_index instantiation registers its storage here so the
+    * driver can reset or dump the whole database without knowing row types.
+    */
+   class table_registry {
+   public:
+      struct table_type {
+         virtual ~table_type() {}
+         virtual void clear() = 0;
+         virtual void dump( std::vector<table_row_dump>& out )const = 0;
+      };
+
+      static table_registry& instance() {
+         static table_registry r;
+         return r;
+      }
+
+      void add( table_type* t ) { _tables.emplace_back( t ); }
+
+      void clear_all() {
+         for( auto& t : _tables ) t->clear();
+      }
+
+      std::vector<table_row_dump> dump_all()const {
+         std::vector<table_row_dump> out;
+         for( const auto& t : _tables ) t->dump( out );
+         return out;
+      }
+
+   private:
+      std::vector<std::unique_ptr<table_type>> _tables;
+   };
+
+   template<typename Key>
+   constexpr int64_t billable_index_overhead() {
+      if constexpr( sizeof(Key) == 8 )
+         return billable_index64_overhead;
+      else if constexpr( sizeof(Key) == 16 )
+         return billable_index128_overhead;
+      else
+         return billable_index256_overhead;
+   }
+
+   template<typename T, typename... Indices>
+   struct table_rows {
+      struct row {
+         T        value;
+         name     payer;
+         int64_t  size;
+      };
+
+      std::map<uint64_t, row> rows;
+      std::tuple<std::set<std::pair<typename Indices::secondary_extractor_type::result_type, uint64_t>>...> secondary;
+      name     table_payer;
+   };
+
+} // namespace native
+
+   template<name::raw TableName, typename T, typename... Indices>
+   class multi_index {
+   private:
+      static_assert( sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices" );
+
+      using store_type = native::table_rows<T, Indices...>;
+      using row_map    = typename std::map<uint64_t, typename store_type::row>;
+
+      struct registered_stores : native::table_registry::table_type {
+         std::map<std::pair<uint64_t, uint64_t>, store_type> stores;
+
+         void clear()override { stores.clear(); }
+
+         void dump( std::vector<native::table_row_dump>& out )const override {
+            for( const auto& s : stores ) {
+               for( const auto& r : s.second.rows ) {
+                  out.push_back( { name(s.first.first), s.first.second, name(TableName), r.first, pack( r.second.value ) } );
+               }
+            }
+         }
+      };
+
+      static std::map<std::pair<uint64_t, uint64_t>, store_type>& stores() {
+         static registered_stores* s = [](){
+            auto* r = new registered_stores();
+            native::table_registry::instance().add( r );
+            return r;
+         }();
+         return s->stores;
+      }
+
+      template<size_t I>
+      using index_at = typename std::tuple_element<I, std::tuple<Indices...>>::type;
+
+      template<size_t I>
+      using secondary_key_at = typename index_at<I>::secondary_extractor_type::result_type;
+
+      template<uint64_t IndexName, size_t I = 0>
+      static constexpr size_t index_position() {
+         static_assert( I < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index" );
+         if constexpr( uint64_t(index_at<I>::index_name) == IndexName )
+            return I;
+         else
+            return index_position<IndexName, I + 1>();
+      }
+
+      template<size_t... Is>
+      static void insert_secondary( store_type& s, const T& obj, std::index_sequence<Is...> ) {
+         ( std::get<Is>( s.secondary ).emplace( typename index_at<Is>::secondary_extractor_type()( obj ), obj.primary_key() ), ... );
+      }
+
+      template<size_t... Is>
+      static void erase_secondary( store_type& s, const T& obj, std::index_sequence<Is...> ) {
+         ( std::get<Is>( s.secondary ).erase( { typename index_at<Is>::secondary_extractor_type()( obj ), obj.primary_key() } ), ... );
+      }
+
+      template<size_t... Is>
+      static int64_t secondary_overhead( std::index_sequence<Is...> ) {
+         return ( int64_t(0) + ... + native::billable_index_overhead<secondary_key_at<Is>>() );
+      }
+
+      static int64_t table_overhead() {
+         return native::billable_table_overhead * int64_t( 1 + sizeof...(Indices) );
+      }
+
+      name         _code;
+      uint64_t     _scope;
+      store_type*  _store;
+
+      mutable uint64_t _next_primary_key;
+
+      enum next_primary_key_tags : uint64_t {
+         no_available_primary_key = static_cast<uint64_t>(-2),
+         unset_next_primary_key   = static_cast<uint64_t>(-1)
+      };
+
+      static void insert_row( store_type& s, const T& obj, name payer, int64_t size ) {
+         auto pk = obj.primary_key();
+         auto& h = native::host::instance();
+         if( s.rows.empty() ) {
+            s.table_payer = payer;
+            h.add_ram( payer, table_overhead() );
+         }
+         s.rows.emplace( pk, typename store_type::row{ obj, payer, size } );
+         insert_secondary( s, obj, std::index_sequence_for<Indices...>() );
+         h.add_ram( payer, size + native::billable_row_overhead + secondary_overhead( std::index_sequence_for<Indices...>() ) );
+      }
+
+      static void remove_row( store_type& s, typename row_map::iterator itr ) {
+         auto& h = native::host::instance();
+         h.add_ram( itr->second.payer, -( itr->second.size + native::billable_row_overhead + secondary_overhead( std::index_sequence_for<Indices...>() ) ) );
+         erase_secondary( s, itr->second.value, std::index_sequence_for<Indices...>() );
+         s.rows.erase( itr );
+         if( s.rows.empty() ) {
+            h.add_ram( s.table_payer, -table_overhead() );
+         }
+      }
+
+   public:
+      class const_iterator {
+      public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type        = const T;
+         using difference_type   = std::ptrdiff_t;
+         using pointer           = const T*;
+         using reference         = const T&;
+
+         const_iterator() = default;
+         explicit const_iterator( typename row_map::const_iterator i ) : _itr(i) {}
+
+         const T& operator*()const { return _itr->second.value; }
+         const T* operator->()const { return &_itr->second.value; }
+
+         const_iterator& operator++() { ++_itr; return *this; }
+         const_iterator& operator--() { --_itr; return *this; }
+         const_iterator operator++(int) { const_iterator r = *this; ++_itr; return r; }
+         const_iterator operator--(int) { const_iterator r = *this; --_itr; return r; }
+
+         friend bool operator == ( const const_iterator& a, const const_iterator& b ) { return a._itr == b._itr; }
+         friend bool operator != ( const const_iterator& a, const const_iterator& b ) { return a._itr != b._itr; }
+
+      private:
+         friend class multi_index;
+         typename row_map::const_iterator _itr;
+      };
+
+      using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+      template<size_t I>
+      class index {
+      public:
+         using secondary_key_type = secondary_key_at<I>;
+         using set_type           = std::set<std::pair<secondary_key_type, uint64_t>>;
+
+         class const_iterator {
+         public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type        = const T;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const T*;
+            using reference         = const T&;
+
+            const_iterator() = default;
+            const_iterator( const multi_index* mi, typename set_type::const_iterator i ) : _mi(mi), _itr(i) {}
+
+            const T& operator*()const { return _mi->_store->rows.at( _itr->second ).value; }
+            const T* operator->()const { return &**this; }
+
+            const_iterator& operator++() { ++_itr; return *this; }
+            const_iterator& operator--() { --_itr; return *this; }
+            const_iterator operator++(int) { const_iterator r = *this; ++_itr; return r; }
+            const_iterator operator--(int) { const_iterator r = *this; --_itr; return r; }
+
+            friend bool operator == ( const const_iterator& a, const const_iterator& b ) { return a._itr == b._itr; }
+            friend bool operator != ( const const_iterator& a, const const_iterator& b ) { return a._itr != b._itr; }
+
+         private:
+            friend class index;
+            const multi_index*                _mi = nullptr;
+            typename set_type::const_iterator _itr;
+         };
+
+         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+         explicit index( multi_index* mi ) : _multidx(mi) {}
+
+         const_iterator cbegin()const { return const_iterator( _multidx, set().begin() ); }
+         const_iterator begin()const  { return cbegin(); }
+         const_iterator cend()const   { return const_iterator( _multidx, set().end() ); }
+         const_iterator end()const    { return cend(); }
+
+         const_reverse_iterator rbegin()const { return const_reverse_iterator( cend() ); }
+         const_reverse_iterator rend()const   { return const_reverse_iterator( cbegin() ); }
+
+         const_iterator lower_bound( secondary_key_type secondary )const {
+            return const_iterator( _multidx, set().lower_bound( { secondary, 0 } ) );
+         }
+
+         const_iterator upper_bound( secondary_key_type secondary )const {
+            return const_iterator( _multidx, set().upper_bound( { secondary, std::numeric_limits<uint64_t>::max() } ) );
+         }
+
+         const_iterator find( secondary_key_type secondary )const {
+            auto itr = lower_bound( secondary );
+            if( itr == cend() ) return itr;
+            if( itr._itr->first != secondary ) return cend();
+            return itr;
+         }
+
+         const T& get( secondary_key_type secondary, const char* error_msg = "unable to find secondary key" )const {
+            auto result = find( secondary );
+            check( result != cend(), error_msg );
+            return *result;
+         }
+
+         const_iterator iterator_to( const T& obj )const {
+            return const_iterator( _multidx, set().find( { typename index_at<I>::secondary_extractor_type()( obj ), obj.primary_key() } ) );
+         }
+
+         template<typename Lambda>
+         void modify( const_iterator itr, name payer, Lambda&& updater ) {
+            check( itr != cend(), "cannot pass end iterator to modify" );
+            _multidx->modify( *itr, payer, std::forward<Lambda&&>(updater) );
+         }
+
+         const_iterator erase( const_iterator itr ) {
+            check( itr != cend(), "cannot pass end iterator to erase" );
+            const auto& obj = *itr;
+            ++itr;
+            _multidx->erase( obj );
+            return itr;
+         }
+
+         name get_code()const      { return _multidx->get_code(); }
+         uint64_t get_scope()const { return _multidx->get_scope(); }
+
+      private:
+         const set_type& set()const { return std::get<I>( _multidx->_store->secondary ); }
+
+         multi_index* _multidx;
+      };
+
+      multi_index( name code, uint64_t scope )
+      :_code(code), _scope(scope), _store(&stores()[{ code.value, scope }]), _next_primary_key(unset_next_primary_key)
+      {}
+
+      multi_index( const multi_index& ) = delete;
+      multi_index( multi_index&& ) = default;
+
+      name get_code()const      { return _code; }
+      uint64_t get_scope()const { return _scope; }
+
+      const_iterator cbegin()const { return const_iterator( _store->rows.cbegin() ); }
+      const_iterator begin()const  { return cbegin(); }
+      const_iterator cend()const   { return const_iterator( _store->rows.cend() ); }
+      const_iterator end()const    { return cend(); }
+
+      const_reverse_iterator crbegin()const { return const_reverse_iterator( cend() ); }
+      const_reverse_iterator rbegin()const  { return crbegin(); }
+      const_reverse_iterator crend()const   { return const_reverse_iterator( cbegin() ); }
+      const_reverse_iterator rend()const    { return crend(); }
+
+      const_iterator lower_bound( uint64_t primary )const {
+         return const_iterator( _store->rows.lower_bound( primary ) );
+      }
+
+      const_iterator upper_bound( uint64_t primary )const {
+         return const_iterator( _store->rows.upper_bound( primary ) );
+      }
+
+      uint64_t available_primary_key()const {
+         if( _next_primary_key == unset_next_primary_key ) {
+            _next_primary_key = _store->rows.empty() ? 0 : _store->rows.rbegin()->first + 1;
+            if( _next_primary_key >= no_available_primary_key ) _next_primary_key = no_available_primary_key;
+         }
+         check( _next_primary_key < no_available_primary_key, "next primary key in table is at autoincrement limit" );
+         return _next_primary_key;
+      }
+
+      template<name::raw IndexName>
+      auto get_index() {
+         return index<index_position<static_cast<uint64_t>(IndexName)>()>( this );
+      }
+
+      template<name::raw IndexName>
+      auto get_index()const {
+         return index<index_position<static_cast<uint64_t>(IndexName)>()>( const_cast<multi_index*>(this) );
+      }
+
+      const_iterator iterator_to( const T& obj )const {
+         return const_iterator( _store->rows.find( obj.primary_key() ) );
+      }
+
+      template<typename Lambda>
+      const_iterator emplace( name payer, Lambda&& constructor ) {
+         auto& h = native::host::instance();
+         check( _code == h.context.receiver, "cannot create objects in table of another contract" );
+
+         T obj;
+         constructor( obj );
+
+         auto pk = obj.primary_key();
+         check( _store->rows.find( pk ) == _store->rows.end(), "could not insert object, most likely a uniqueness constraint was violated" );
+
+         insert_row( *_store, obj, payer, int64_t( pack_size( obj ) ) );
+
+         if( pk >= _next_primary_key ) {
+            _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+         }
+
+         store_type* s = _store;
+         h.on_undo( [s, pk]() {
+            remove_row( *s, s->rows.find( pk ) );
+         } );
+
+         return const_iterator( _store->rows.find( pk ) );
+      }
+
+      template<typename Lambda>
+      void modify( const_iterator itr, name payer, Lambda&& updater ) {
+         check( itr != end(), "cannot pass end iterator to modify" );
+         modify( *itr, payer, std::forward<Lambda&&>(updater) );
+      }
+
+      template<typename Lambda>
+      void modify( const T& obj, name payer, Lambda&& updater ) {
+         auto& h = native::host::instance();
+         check( _code == h.context.receiver, "cannot modify objects in table of another contract" );
+
+         auto pk   = obj.primary_key();
+         auto itr  = _store->rows.find( pk );
+         check( itr != _store->rows.end(), "object passed to modify is not in multi_index" );
+
+         auto old = itr->second;
+         erase_secondary( *_store, itr->second.value, std::index_sequence_for<Indices...>() );
+
+         updater( itr->second.value );
+         check( pk == itr->second.value.primary_key(), "updater cannot change primary key when modifying an object" );
+
+         insert_secondary( *_store, itr->second.value, std::index_sequence_for<Indices...>() );
+
+         auto new_payer = payer ? payer : old.payer;
+         auto new_size  = int64_t( pack_size( itr->second.value ) );
+         auto overhead  = native::billable_row_overhead + secondary_overhead( std::index_sequence_for<Indices...>() );
+         h.add_ram( old.payer, -( old.size + overhead ) );
+         h.add_ram( new_payer, new_size + overhead );
+         itr->second.payer = new_payer;
+         itr->second.size  = new_size;
+
+         store_type* s = _store;
+         h.on_undo( [s, pk, old]() {
+            auto& h   = native::host::instance();
+            auto  cur = s->rows.find( pk );
+            auto overhead = native::billable_row_overhead + secondary_overhead( std::index_sequence_for<Indices...>() );
+            h.add_ram( cur->second.payer, -( cur->second.size + overhead ) );
+            h.add_ram( old.payer, old.size + overhead );
+            erase_secondary( *s, cur->second.value, std::index_sequence_for<Indices...>() );
+            cur->second = old;
+            insert_secondary( *s, cur->second.value, std::index_sequence_for<Indices...>() );
+         } );
+      }
+
+      const T& get( uint64_t primary, const char* error_msg = "unable to find key" )const {
+         auto result = find( primary );
+         check( result != cend(), error_msg );
+         return *result;
+      }
+
+      const_iterator find( uint64_t primary )const {
+         return const_iterator( _store->rows.find( primary ) );
+      }
+
+      const_iterator require_find( uint64_t primary, const char* error_msg = "unable to find key" )const {
+         auto itr = find( primary );
+         check( itr != cend(), error_msg );
+         return itr;
+      }
+
+      const_iterator erase( const_iterator itr ) {
+         check( itr != end(), "cannot pass end iterator to erase" );
+         const auto& obj = *itr;
+         ++itr;
+         erase( obj );
+         return itr;
+      }
+
+      void erase( const T& obj ) {
+         auto& h = native::host::instance();
+         check( _code == h.context.receiver, "cannot erase objects in table of another contract" );
+
+         auto pk  = obj.primary_key();
+         auto itr = _store->rows.find( pk );
+         check( itr != _store->rows.end(), "object passed to erase is not in multi_index" );
+
+         auto old = itr->second;
+         remove_row( *_store, itr );
+
+         store_type* s = _store;
+         h.on_undo( [s, old]() {
+            insert_row( *s, old.value, old.payer, old.size );
+         } );
+      }
+   };
+
+} // namespace eosio
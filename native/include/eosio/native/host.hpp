@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+   struct permission_level;
+   struct action;
+
+namespace native {
+
+   /// Thrown by require_auth; nodeos reports it as missing_auth_exception
+   struct missing_auth_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   /**
+    * Per-process chain state standing in for nodeos: the accounts that
+    * exist, the head block time, the authorizations of the action being
+    * executed and the side effects (inline actions, notifications) it
+    * produced.  Table rows live in the multi_index stores themselves.
+    */
+   class host {
+   public:
+      static host& instance();
+
+      /// Receiver, first receiver and authorizations of the executing action
+      struct context_type {
+         name                          receiver;
+         name                          first_receiver;
+         std::vector<std::pair<name, name>> authorization;
+      };
+
+      std::set<name>                   accounts;
+      time_point                       block_time;
+      context_type                     context;
+
+      std::vector<action>&             inline_actions();
+      std::vector<name>                notifications;
+
+      /// Billable RAM per payer, using the nodeos billable sizes
+      std::map<name, int64_t>          ram_usage;
+
+      /// Replaces secp256k1 recovery; returns true when `sig` is accepted for `key`
+      std::function<bool( const checksum256&, const signature&, const public_key& )> verify_signature;
+
+      /// Undo log: every table mutation records how to revert itself
+      size_t undo_mark()const { return _undo.size(); }
+      void   on_undo( std::function<void()> f ) { _undo.emplace_back( std::move(f) ); }
+      void   undo_to( size_t mark );
+      void   discard_undo() { _undo.clear(); }
+
+      void   add_ram( name payer, int64_t delta );
+
+      /// Clears every table, account, pending side effect and RAM counter
+      void   reset();
+
+   private:
+      host();
+
+      std::vector<std::function<void()>> _undo;
+   };
+
+   /// Deterministic stand-in signature accepted by the default verifier
+   signature simulated_signature( const checksum256& digest, const public_key& key );
+
+   /// nodeos RAM charges per object (config::billable_size_v, 16-byte aligned)
+   static constexpr int64_t billable_row_overhead       = 112; // key_value_object
+   static constexpr int64_t billable_index64_overhead   = 128; // index64_object
+   static constexpr int64_t billable_index128_overhead  = 144; // index128_object
+   static constexpr int64_t billable_index256_overhead  = 160; // index256_object
+   static constexpr int64_t billable_table_overhead     = 112; // table_id_object
+
+} } // namespace eosio::native
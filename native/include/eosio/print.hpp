@@ -0,0 +1,23 @@
+#pragma once
+
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+#include <eosio/name.hpp>
+
+namespace eosio {
+
+   inline void print() {}
+
+   template<typename Arg, typename... Args>
+   void print( Arg&& a, Args&&... args ) {
+      if constexpr( std::is_same_v<std::decay_t<Arg>, name> ) {
+         std::cout << a.to_string();
+      } else {
+         std::cout << a;
+      }
+      print( std::forward<Args>(args)... );
+   }
+
+} // namespace eosio
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <eosio/time.hpp>
+#include <eosio/native/host.hpp>
+
+namespace eosio {
+
+   inline time_point current_time_point() {
+      return native::host::instance().block_time;
+   }
+
+   inline block_timestamp current_block_time() {
+      return block_timestamp( native::host::instance().block_time );
+   }
+
+} // namespace eosio
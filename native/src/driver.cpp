@@ -0,0 +1,389 @@
+// Replays a text action stream against the native build of the contract.
+//
+//    horuspay_sim [--contract horuspay] [--start <usec>] [--repeat <n>] [--dump <file>] [--verbose] <stream>
+//
+// Stream lines, tokens separated by blanks, `#` starts a comment:
+//
+//    account <name>...                                    accounts that exist
+//    wait <blocks>                                        advance time by blocks of 0.5s
+//    issue <to> <amount> <symbol>                         chain replays only, ignored here
+//    transfer <from> <memo> <amount> <symbol> <contract>  deposit notification from a token contract
+//    push <signer> <action> <args>...                     horuspay action
+//
+// Action arguments follow the action signature: assets are `<amount> <symbol>`, extended
+// assets add the token contract, `-` is an empty optional, addtimes entries are
+// `user:seconds[:description]`, batchapprove approvals `user:seconds` or `user:-` and entry
+// ids the remaining tokens.
+//
+// Like the chain tester, every successful push is its own 0.5s block, failed pushes leave the
+// time unchanged and transfers land in the pending block. --start is the time of the first
+// block in microseconds since epoch.
+
+#include <horuspay.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+
+namespace {
+
+   using contract_type = horuspay::horuspay;
+
+   constexpr int64_t block_interval_us = 500000;
+
+   struct op {
+      size_t                              line = 0;
+      name                                signer;
+      name                                first_receiver;
+      int64_t                             wait_blocks = 0;
+      std::vector<name>                   accounts;
+      std::function<void(contract_type&)> apply;
+   };
+
+   struct args_reader {
+      const std::vector<std::string>& tokens;
+      size_t                          pos;
+
+      const std::string& next() {
+         if( pos >= tokens.size() ) throw std::runtime_error( "missing argument" );
+         return tokens[pos++];
+      }
+
+      bool done()const { return pos >= tokens.size(); }
+
+      name read_name() { return name( next() ); }
+
+      int64_t  read_int()  { return std::stoll( next() ); }
+      uint64_t read_uint() { return std::stoull( next() ); }
+
+      static asset parse_asset( const std::string& amount, const std::string& sym ) {
+         auto dot = amount.find( '.' );
+         uint8_t precision = dot == std::string::npos ? 0 : uint8_t( amount.size() - dot - 1 );
+         std::string digits = amount;
+         if( dot != std::string::npos ) digits.erase( dot, 1 );
+         return asset( std::stoll( digits ), symbol( sym, precision ) );
+      }
+
+      asset read_asset() {
+         const auto& amount = next();
+         return parse_asset( amount, next() );
+      }
+
+      extended_asset read_extended_asset() {
+         auto quantity = read_asset();
+         return extended_asset( quantity, read_name() );
+      }
+
+      std::optional<std::string> read_optional_string() {
+         const auto& t = next();
+         if( t == "-" ) return {};
+         return t;
+      }
+
+      std::optional<name> read_optional_name() {
+         const auto& t = next();
+         if( t == "-" ) return {};
+         return name( t );
+      }
+
+      std::optional<int64_t> read_optional_int() {
+         const auto& t = next();
+         if( t == "-" ) return {};
+         return std::stoll( t );
+      }
+
+      std::vector<std::string> rest_split( const std::string& t ) {
+         std::vector<std::string> parts;
+         std::stringstream ss( t );
+         for( std::string p; std::getline( ss, p, ':' ); ) parts.push_back( p );
+         return parts;
+      }
+
+      std::vector<uint64_t> read_uints() {
+         std::vector<uint64_t> values;
+         while( !done() ) values.push_back( read_uint() );
+         return values;
+      }
+
+      std::vector<contract_type::time_entry> read_time_entries() {
+         std::vector<contract_type::time_entry> entries;
+         while( !done() ) {
+            auto parts = rest_split( next() );
+            if( parts.size() < 2 ) throw std::runtime_error( "time entry must be user:seconds[:description]" );
+            contract_type::time_entry e;
+            e.user    = name( parts[0] );
+            e.seconds = std::stoull( parts[1] );
+            if( parts.size() > 2 ) e.description = parts[2];
+            entries.push_back( e );
+         }
+         return entries;
+      }
+
+      std::vector<contract_type::approval> read_approvals() {
+         std::vector<contract_type::approval> approvals;
+         while( !done() ) {
+            auto parts = rest_split( next() );
+            if( parts.size() != 2 ) throw std::runtime_error( "approval must be user:seconds or user:-" );
+            contract_type::approval a;
+            a.user = name( parts[0] );
+            if( parts[1] != "-" ) a.seconds = std::stoll( parts[1] );
+            approvals.push_back( a );
+         }
+         return approvals;
+      }
+   };
+
+   using action_parser = std::function<std::function<void(contract_type&)>( args_reader& )>;
+
+   const std::map<std::string, action_parser>& action_parsers() {
+      static const std::map<std::string, action_parser> parsers = {
+         { "create", []( args_reader& r ) {
+            auto project = r.read_name(); auto owner = r.read_name(); auto rate = r.read_extended_asset();
+            return [=]( contract_type& c ) { c.create( project, owner, rate ); }; } },
+         { "addtoken", []( args_reader& r ) {
+            auto contract = r.read_name();
+            return [=]( contract_type& c ) { c.addtoken( contract ); }; } },
+         { "rmvtoken", []( args_reader& r ) {
+            auto contract = r.read_name();
+            return [=]( contract_type& c ) { c.rmvtoken( contract ); }; } },
+         { "adduser", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto user = r.read_name();
+            return [=]( contract_type& c ) { c.adduser( project, manager, user ); }; } },
+         { "removeuser", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto user = r.read_name();
+            return [=]( contract_type& c ) { c.removeuser( project, manager, user ); }; } },
+         { "addmanager", []( args_reader& r ) {
+            auto project = r.read_name(); auto owner = r.read_name(); auto manager = r.read_name();
+            return [=]( contract_type& c ) { c.addmanager( project, owner, manager ); }; } },
+         { "rmvmanager", []( args_reader& r ) {
+            auto project = r.read_name(); auto owner = r.read_name(); auto manager = r.read_name();
+            return [=]( contract_type& c ) { c.rmvmanager( project, owner, manager ); }; } },
+         { "clockin", []( args_reader& r ) {
+            auto project = r.read_name(); auto user = r.read_name();
+            return [=]( contract_type& c ) { c.clockin( project, user ); }; } },
+         { "clockout", []( args_reader& r ) {
+            auto project = r.read_name(); auto user = r.read_name(); auto description = r.read_optional_string();
+            return [=]( contract_type& c ) { c.clockout( project, user, description ); }; } },
+         { "switchclock", []( args_reader& r ) {
+            auto from = r.read_name(); auto to = r.read_name(); auto user = r.read_name(); auto description = r.read_optional_string();
+            return [=]( contract_type& c ) { c.switchclock( from, to, user, description ); }; } },
+         { "addtime", []( args_reader& r ) {
+            auto project = r.read_name(); auto user = r.read_name(); auto seconds = r.read_uint();
+            auto description = r.read_optional_string(); auto manager = r.read_optional_name();
+            return [=]( contract_type& c ) { c.addtime( project, user, seconds, description, manager ); }; } },
+         { "addtimes", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto entries = r.read_time_entries();
+            return [=]( contract_type& c ) { c.addtimes( project, manager, entries ); }; } },
+         { "approve", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto user = r.read_name();
+            auto seconds = r.read_optional_int();
+            return [=]( contract_type& c ) { c.approve( project, manager, user, seconds ); }; } },
+         { "batchapprove", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto approvals = r.read_approvals();
+            return [=]( contract_type& c ) { c.batchapprove( project, manager, approvals ); }; } },
+         { "approveentry", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto ids = r.read_uints();
+            return [=]( contract_type& c ) { c.approveentry( project, manager, ids ); }; } },
+         { "declineentry", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto ids = r.read_uints();
+            return [=]( contract_type& c ) { c.declineentry( project, manager, ids ); }; } },
+         { "compact", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name();
+            auto days = uint32_t( r.read_uint() ); auto max_rows = uint32_t( r.read_uint() );
+            return [=]( contract_type& c ) { c.compact( project, manager, days, max_rows ); }; } },
+         { "runpayroll", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto max_rows = uint32_t( r.read_uint() );
+            return [=]( contract_type& c ) { c.runpayroll( project, manager, max_rows ); }; } },
+         { "withdraw", []( args_reader& r ) {
+            auto user = r.read_name(); auto quantity = r.read_asset();
+            return [=]( contract_type& c ) { c.withdraw( user, quantity ); }; } },
+         { "decline", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto user = r.read_name();
+            auto seconds = r.read_int();
+            return [=]( contract_type& c ) { c.decline( project, manager, user, seconds ); }; } },
+         { "setuserrate", []( args_reader& r ) {
+            auto project = r.read_name(); auto manager = r.read_name(); auto user = r.read_name();
+            auto rate = r.read_extended_asset();
+            return [=]( contract_type& c ) { c.setuserrate( project, manager, user, rate ); }; } },
+      };
+      return parsers;
+   }
+
+   std::vector<op> parse_stream( std::istream& in, name contract ) {
+      std::vector<op> ops;
+      std::string line;
+      size_t line_no = 0;
+
+      while( std::getline( in, line ) ) {
+         ++line_no;
+         auto hash = line.find( '#' );
+         if( hash != std::string::npos ) line.erase( hash );
+
+         std::vector<std::string> tokens;
+         std::stringstream ss( line );
+         for( std::string t; ss >> t; ) tokens.push_back( t );
+         if( tokens.empty() ) continue;
+
+         try {
+            op o;
+            o.line = line_no;
+            args_reader r{ tokens, 1 };
+            const auto& cmd = tokens[0];
+
+            if( cmd == "account" ) {
+               while( !r.done() ) o.accounts.push_back( r.read_name() );
+            } else if( cmd == "wait" ) {
+               o.wait_blocks = r.read_int();
+            } else if( cmd == "issue" ) {
+               continue;
+            } else if( cmd == "transfer" ) {
+               auto from     = r.read_name();
+               auto memo     = r.next();
+               auto quantity = r.read_asset();
+               o.signer         = from;
+               o.first_receiver = r.read_name();
+               o.apply = [=]( contract_type& c ) { c.on_transfer( from, contract, quantity, memo ); };
+            } else if( cmd == "push" ) {
+               o.signer         = r.read_name();
+               o.first_receiver = contract;
+               const auto& action = r.next();
+               auto parser = action_parsers().find( action );
+               if( parser == action_parsers().end() ) throw std::runtime_error( "unknown action " + action );
+               o.apply = parser->second( r );
+            } else {
+               throw std::runtime_error( "unknown command " + cmd );
+            }
+
+            if( !r.done() ) throw std::runtime_error( "too many arguments" );
+            ops.push_back( std::move(o) );
+         } catch( const std::exception& e ) {
+            throw std::runtime_error( "line " + std::to_string(line_no) + ": " + e.what() );
+         }
+      }
+      return ops;
+   }
+
+   struct replay_result {
+      uint64_t actions  = 0;
+      uint64_t failures = 0;
+   };
+
+   replay_result replay( const std::vector<op>& ops, name contract, int64_t start_us, bool verbose ) {
+      auto& h = native::host::instance();
+      h.reset();
+      h.accounts.insert( contract );
+      h.block_time = time_point( microseconds( start_us ) );
+
+      replay_result result;
+      for( const auto& o : ops ) {
+         for( auto a : o.accounts ) h.accounts.insert( a );
+         if( o.wait_blocks ) h.block_time += microseconds( o.wait_blocks * block_interval_us );
+         if( !o.apply ) continue;
+
+         h.context.receiver       = contract;
+         h.context.first_receiver = o.first_receiver;
+         h.context.authorization  = { { o.signer, name("active") } };
+         h.inline_actions().clear();
+         h.notifications.clear();
+
+         ++result.actions;
+         auto mark = h.undo_mark();
+         try {
+            contract_type c( contract, o.first_receiver, datastream<const char*>( nullptr, 0 ) );
+            o.apply( c );
+         } catch( const std::exception& e ) {
+            h.undo_to( mark );
+            ++result.failures;
+            if( verbose ) std::cerr << "line " << o.line << ": " << e.what() << std::endl;
+            continue;
+         }
+         h.discard_undo();
+
+         // transfers arrive in the pending block, every pushed action closes its own block
+         if( o.first_receiver == contract ) h.block_time += microseconds( block_interval_us );
+      }
+      return result;
+   }
+
+   // One line per contract row: scope table primary_key hex, sorted
+   void dump_tables( std::ostream& out, name contract ) {
+      std::vector<std::string> lines;
+      for( const auto& row : native::table_registry::instance().dump_all() ) {
+         if( row.code != contract ) continue;
+
+         static const char* hex = "0123456789abcdef";
+         std::string data;
+         for( unsigned char c : row.data ) {
+            data += hex[c >> 4];
+            data += hex[c & 0xf];
+         }
+         lines.push_back( name( row.scope ).to_string() + " " + row.table.to_string() + " "
+                          + std::to_string( row.primary_key ) + " " + data );
+      }
+      std::sort( lines.begin(), lines.end() );
+      for( const auto& l : lines ) out << l << "\n";
+   }
+
+   int usage() {
+      std::cerr << "usage: horuspay_sim [--contract <name>] [--start <usec>] [--repeat <n>] [--dump <file>] [--verbose] <stream>" << std::endl;
+      return 2;
+   }
+
+} // anonymous namespace
+
+int main( int argc, char** argv ) {
+   name        contract( "horuspay" );
+   int64_t     start_us = 946684800000000ll; // 2000-01-01, the block_timestamp epoch
+   uint64_t    repeat   = 1;
+   std::string dump_file;
+   std::string stream_file;
+   bool        verbose  = false;
+
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( arg == "--contract" && i + 1 < argc )    contract    = name( argv[++i] );
+      else if( arg == "--start" && i + 1 < argc )  start_us    = std::stoll( argv[++i] );
+      else if( arg == "--repeat" && i + 1 < argc ) repeat      = std::stoull( argv[++i] );
+      else if( arg == "--dump" && i + 1 < argc )   dump_file   = argv[++i];
+      else if( arg == "--verbose" )                verbose     = true;
+      else if( stream_file.empty() && arg[0] != '-' ) stream_file = arg;
+      else return usage();
+   }
+   if( stream_file.empty() || repeat == 0 ) return usage();
+
+   try {
+      std::ifstream in( stream_file );
+      if( !in ) throw std::runtime_error( "can't open " + stream_file );
+      auto ops = parse_stream( in, contract );
+
+      replay_result result;
+      auto begin = std::chrono::steady_clock::now();
+      for( uint64_t i = 0; i < repeat; ++i ) {
+         result = replay( ops, contract, start_us, verbose && i == 0 );
+      }
+      double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+
+      std::cerr << "actions " << result.actions << " failed " << result.failures
+                << " runs " << repeat << " seconds " << elapsed
+                << " actions/s " << uint64_t( elapsed > 0 ? result.actions * repeat / elapsed : 0 ) << std::endl;
+
+      if( !dump_file.empty() ) {
+         std::ofstream out( dump_file );
+         if( !out ) throw std::runtime_error( "can't write " + dump_file );
+         dump_tables( out, contract );
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
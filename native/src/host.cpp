@@ -0,0 +1,177 @@
+#include <eosio/eosio.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace eosio { namespace native {
+
+   host& host::instance() {
+      static host h;
+      return h;
+   }
+
+   host::host() {
+      verify_signature = []( const checksum256& digest, const signature& sig, const public_key& key ) {
+         return sig == simulated_signature( digest, key );
+      };
+   }
+
+   std::vector<action>& host::inline_actions() {
+      static std::vector<action> queue;
+      return queue;
+   }
+
+   void host::undo_to( size_t mark ) {
+      while( _undo.size() > mark ) {
+         auto f = std::move( _undo.back() );
+         _undo.pop_back();
+         f();
+      }
+   }
+
+   void host::add_ram( name payer, int64_t delta ) {
+      ram_usage[payer] += delta;
+   }
+
+   void host::reset() {
+      table_registry::instance().clear_all();
+      accounts.clear();
+      block_time = time_point();
+      context    = context_type();
+      inline_actions().clear();
+      notifications.clear();
+      ram_usage.clear();
+      _undo.clear();
+   }
+
+   signature simulated_signature( const checksum256& digest, const public_key& key ) {
+      std::vector<char> buf;
+      auto d = digest.extract_as_byte_array();
+      buf.insert( buf.end(), d.begin(), d.end() );
+      buf.insert( buf.end(), key.data.begin(), key.data.end() );
+      auto h = sha256( buf.data(), buf.size() ).extract_as_byte_array();
+
+      signature sig;
+      sig.type = key.type;
+      sig.data.fill( 0 );
+      std::copy( h.begin(), h.end(), sig.data.begin() );
+      return sig;
+   }
+
+namespace {
+
+   constexpr uint32_t k[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+   };
+
+   inline uint32_t rotr( uint32_t x, uint32_t n ) { return (x >> n) | (x << (32 - n)); }
+
+   void sha256_block( uint32_t* state, const uint8_t* block ) {
+      uint32_t w[64];
+      for( int i = 0; i < 16; ++i ) {
+         w[i] = (uint32_t(block[i*4]) << 24) | (uint32_t(block[i*4+1]) << 16) | (uint32_t(block[i*4+2]) << 8) | uint32_t(block[i*4+3]);
+      }
+      for( int i = 16; i < 64; ++i ) {
+         uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+         uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+         w[i] = w[i-16] + s0 + w[i-7] + s1;
+      }
+
+      uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+      uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+      for( int i = 0; i < 64; ++i ) {
+         uint32_t s1    = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+         uint32_t ch    = (e & f) ^ (~e & g);
+         uint32_t temp1 = h + s1 + ch + k[i] + w[i];
+         uint32_t s0    = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+         uint32_t maj   = (a & b) ^ (a & c) ^ (b & c);
+         uint32_t temp2 = s0 + maj;
+         h = g; g = f; f = e; e = d + temp1;
+         d = c; c = b; b = a; a = temp1 + temp2;
+      }
+      state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+      state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+   }
+
+} // anonymous namespace
+
+} } // namespace eosio::native
+
+namespace eosio {
+
+   bool has_auth( name n ) {
+      const auto& auths = native::host::instance().context.authorization;
+      return std::any_of( auths.begin(), auths.end(), [&]( const auto& a ) { return a.first == n; } );
+   }
+
+   void require_auth( name n ) {
+      if( !has_auth( n ) ) {
+         throw native::missing_auth_exception( "missing authority of " + n.to_string() );
+      }
+   }
+
+   void require_auth( const permission_level& level ) {
+      const auto& auths = native::host::instance().context.authorization;
+      if( std::find( auths.begin(), auths.end(), std::make_pair( level.actor, level.permission ) ) == auths.end() ) {
+         throw native::missing_auth_exception( "missing authority of " + level.actor.to_string() + "/" + level.permission.to_string() );
+      }
+   }
+
+   bool is_account( name n ) {
+      return native::host::instance().accounts.count( n ) > 0;
+   }
+
+   void require_recipient( name notify_account ) {
+      auto& notified = native::host::instance().notifications;
+      if( std::find( notified.begin(), notified.end(), notify_account ) == notified.end() ) {
+         notified.push_back( notify_account );
+      }
+   }
+
+   checksum256 sha256( const char* data, uint32_t length ) {
+      uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+      uint32_t full = length / 64;
+      for( uint32_t i = 0; i < full; ++i ) {
+         native::sha256_block( state, p + i * 64 );
+      }
+
+      uint8_t tail[128] = {};
+      uint32_t rest = length % 64;
+      std::memcpy( tail, p + full * 64, rest );
+      tail[rest] = 0x80;
+      uint32_t tail_len = rest < 56 ? 64 : 128;
+      uint64_t bits = uint64_t(length) * 8;
+      for( int i = 0; i < 8; ++i ) {
+         tail[tail_len - 1 - i] = uint8_t( bits >> (8 * i) );
+      }
+      native::sha256_block( state, tail );
+      if( tail_len == 128 ) native::sha256_block( state, tail + 64 );
+
+      std::array<uint8_t, 32> out;
+      for( int i = 0; i < 8; ++i ) {
+         out[i*4]   = uint8_t( state[i] >> 24 );
+         out[i*4+1] = uint8_t( state[i] >> 16 );
+         out[i*4+2] = uint8_t( state[i] >> 8 );
+         out[i*4+3] = uint8_t( state[i] );
+      }
+      return checksum256( out );
+   }
+
+   void assert_sha256( const char* data, uint32_t length, const checksum256& hash ) {
+      check( sha256( data, length ) == hash, "hash mismatch" );
+   }
+
+   void assert_recover_key( const checksum256& digest, const signature& sig, const public_key& pubkey ) {
+      check( native::host::instance().verify_signature( digest, sig, pubkey ), "Error expected key different than recovered key" );
+   }
+
+} // namespace eosio
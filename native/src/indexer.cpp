@@ -0,0 +1,711 @@
+// Aggregates the logevent actions of the contract (see setsink) from action trace dumps into a
+// memory-mapped index of time and payments per project, user and week, and answers reports from
+// it without a chain.
+//
+//    horuspay_indexer [--index <file>] [--contract horuspay] [--binary] [--rebuild] [--export <file>] ingest <input>|-
+//    horuspay_indexer [--index <file>] [--from <week>] [--to <week>] [--seconds] query <project> [<user>]
+//
+// JSON lines input holds one trace per line, an action trace or a transaction trace with its
+// action_traces, as nodeos and the chain tester print them: every object with an `act` member is
+// an action trace and takes the `block_time` of the nearest object that has one. Only logevent
+// actions executed by the contract itself are counted, not their copies delivered to the sink,
+// and their `data` may be the decoded action or its hex (also read from `hex_data`).
+//
+// Binary input is a sequence of 52 byte records, the block_timestamp slot followed by the packed
+// logevent data, as written by --export.
+//
+// The index keeps the input it was built from (path, device and inode, and a hash of its first
+// bytes) and the byte offset up to the last whole record consumed, and the next ingest of the same
+// file continues from that offset, so a dump that only grows is indexed incrementally. Another
+// file, or one that was truncated or rewritten, is refused, as is standard input once something
+// was indexed; --rebuild starts over. A last line without its newline is left for the next
+// ingest. Weeks start on Monday 00:00 UTC of block time and are numbered like the periods of the
+// rollups table (week 0 starts on Monday 1969-12-29), and --from/--to take a week or a YYYY-MM-DD
+// date within it. Times are reported in hours, or in seconds with --seconds, and amounts
+// in units of the project token. Withdrawals are kept under the empty project `.`.
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+using namespace eosio;
+
+namespace {
+
+   constexpr uint32_t seconds_per_week = 7 * 86400;
+
+   // the week_of of the contract: weeks start on Monday, three days before the epoch (a Thursday)
+   constexpr int64_t week_offset_days = 3;
+
+   uint32_t week_of( int64_t unix_seconds ) {
+      return uint32_t( (unix_seconds + week_offset_days * 86400) / seconds_per_week );
+   }
+
+   struct logevent {
+      name    event;
+      name    project;
+      name    user;
+      int64_t seconds = 0;
+      int64_t amount  = 0;
+      int64_t pending = 0;
+
+      EOSLIB_SERIALIZE( logevent, (event)(project)(user)(seconds)(amount)(pending) )
+   };
+
+   struct event_record {
+      block_timestamp time;
+      logevent        event;
+
+      EOSLIB_SERIALIZE( event_record, (time)(event) )
+   };
+
+   constexpr size_t event_record_size = 4 + 6 * 8;
+
+   uint32_t to_unix_seconds( block_timestamp t ) {
+      return t.to_time_point().sec_since_epoch();
+   }
+
+   // days_from_civil and civil_from_days of the proleptic Gregorian calendar
+   int64_t days_from_civil( int64_t y, int m, int d ) {
+      y -= m <= 2;
+      const int64_t era = (y >= 0 ? y : y - 399) / 400;
+      const int64_t yoe = y - era * 400;
+      const int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+      const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      return era * 146097 + doe - 719468;
+   }
+
+   std::string civil_date( int64_t days ) {
+      days += 719468;
+      const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+      const int64_t doe = days - era * 146097;
+      const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+      const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+      const int64_t mp  = (5 * doy + 2) / 153;
+      const int64_t d   = doy - (153 * mp + 2) / 5 + 1;
+      const int64_t m   = mp < 10 ? mp + 3 : mp - 9;
+      // sized for any int64_t fields, the compiler can't bound them to a date
+      char buf[64];
+      std::snprintf( buf, sizeof(buf), "%04lld-%02lld-%02lld", (long long)(yoe + era * 400 + (m <= 2)), (long long)m, (long long)d );
+      return buf;
+   }
+
+   // `2019-01-01T00:00:00.000` as printed for block_time, or a block slot
+   uint32_t parse_block_time( const std::string& s ) {
+      if( !s.empty() && s.find_first_not_of( "0123456789" ) == std::string::npos ) {
+         return to_unix_seconds( block_timestamp( uint32_t(std::stoul( s )) ) );
+      }
+      int y, mo, d, h, mi, sec;
+      if( std::sscanf( s.c_str(), "%d-%d-%dT%d:%d:%d", &y, &mo, &d, &h, &mi, &sec ) != 6 ) {
+         throw std::runtime_error( "bad block_time " + s );
+      }
+      return uint32_t( days_from_civil( y, mo, d ) * 86400 + h * 3600 + mi * 60 + sec );
+   }
+
+   uint32_t parse_week( const std::string& s ) {
+      int y, mo, d;
+      if( s.find( '-' ) != std::string::npos && std::sscanf( s.c_str(), "%d-%d-%d", &y, &mo, &d ) == 3 ) {
+         return week_of( days_from_civil( y, mo, d ) * 86400 );
+      }
+      return uint32_t( std::stoul( s ) );
+   }
+
+   std::vector<char> from_hex( const std::string& hex ) {
+      auto digit = []( char c ) -> int {
+         if( c >= '0' && c <= '9' ) return c - '0';
+         if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+         if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+         throw std::runtime_error( "bad hex data" );
+      };
+      if( hex.size() % 2 ) throw std::runtime_error( "bad hex data" );
+      std::vector<char> bytes( hex.size() / 2 );
+      for( size_t i = 0; i < bytes.size(); ++i ) {
+         bytes[i] = char( digit( hex[2 * i] ) * 16 + digit( hex[2 * i + 1] ) );
+      }
+      return bytes;
+   }
+
+   /**
+    * Just enough JSON for traces: scalars keep their text, object members are `keys`
+    * paired with `items`.
+    */
+   struct json {
+      enum kind_t { null_v, bool_v, number_v, string_v, array_v, object_v };
+
+      kind_t                   kind = null_v;
+      std::string              text;
+      std::vector<std::string> keys;
+      std::vector<json>        items;
+
+      const json* find( std::string_view key )const {
+         for( size_t i = 0; i < keys.size(); ++i ) {
+            if( keys[i] == key ) return &items[i];
+         }
+         return nullptr;
+      }
+   };
+
+   struct json_parser {
+      const char* p;
+      const char* end;
+
+      [[noreturn]] void fail( const char* what ) {
+         throw std::runtime_error( std::string( "bad json: " ) + what );
+      }
+
+      void skip_ws() {
+         while( p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ) ++p;
+      }
+
+      void expect( char c ) {
+         skip_ws();
+         if( p >= end || *p != c ) fail( "unexpected character" );
+         ++p;
+      }
+
+      std::string parse_string() {
+         expect( '"' );
+         std::string s;
+         while( p < end && *p != '"' ) {
+            if( *p == '\\' ) {
+               if( ++p >= end ) break;
+               switch( *p ) {
+                  case 'n': s += '\n'; break;
+                  case 't': s += '\t'; break;
+                  case 'r': s += '\r'; break;
+                  case 'b': s += '\b'; break;
+                  case 'f': s += '\f'; break;
+                  case 'u':
+                     // names, numbers and hex never need it; keep the escape as written
+                     s += "\\u";
+                     break;
+                  default:  s += *p;
+               }
+               ++p;
+            } else {
+               s += *p++;
+            }
+         }
+         if( p >= end ) fail( "unterminated string" );
+         ++p;
+         return s;
+      }
+
+      json parse_value() {
+         skip_ws();
+         if( p >= end ) fail( "unexpected end" );
+         json v;
+         if( *p == '{' ) {
+            v.kind = json::object_v;
+            ++p;
+            skip_ws();
+            if( p < end && *p == '}' ) { ++p; return v; }
+            for( ;; ) {
+               v.keys.push_back( parse_string() );
+               expect( ':' );
+               v.items.push_back( parse_value() );
+               skip_ws();
+               if( p < end && *p == ',' ) { ++p; continue; }
+               expect( '}' );
+               return v;
+            }
+         }
+         if( *p == '[' ) {
+            v.kind = json::array_v;
+            ++p;
+            skip_ws();
+            if( p < end && *p == ']' ) { ++p; return v; }
+            for( ;; ) {
+               v.items.push_back( parse_value() );
+               skip_ws();
+               if( p < end && *p == ',' ) { ++p; continue; }
+               expect( ']' );
+               return v;
+            }
+         }
+         if( *p == '"' ) {
+            v.kind = json::string_v;
+            v.text = parse_string();
+            return v;
+         }
+         auto begin = p;
+         while( p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' ) ++p;
+         v.text.assign( begin, p );
+         if( v.text == "null" )                          v.kind = json::null_v;
+         else if( v.text == "true" || v.text == "false" ) v.kind = json::bool_v;
+         else if( !v.text.empty() )                      v.kind = json::number_v;
+         else fail( "unexpected character" );
+         return v;
+      }
+   };
+
+   json parse_json( const std::string& line ) {
+      json_parser parser{ line.data(), line.data() + line.size() };
+      auto v = parser.parse_value();
+      parser.skip_ws();
+      if( parser.p != parser.end ) parser.fail( "trailing characters" );
+      return v;
+   }
+
+   // Calls `f(trace, act, block_time)` for every action trace under `v`
+   template<typename F>
+   void for_each_action( const json& v, const json* block_time, F&& f ) {
+      if( v.kind == json::object_v ) {
+         if( auto t = v.find( "block_time" ) ) block_time = t;
+         if( auto act = v.find( "act" ); act && act->kind == json::object_v ) f( v, *act, block_time );
+      }
+      for( const auto& item : v.items ) for_each_action( item, block_time, f );
+   }
+
+   const json& field( const json& obj, std::string_view key ) {
+      auto v = obj.find( key );
+      if( !v ) throw std::runtime_error( "logevent without " + std::string( key ) );
+      return *v;
+   }
+
+   std::optional<logevent> read_logevent( const json& trace, const json& act, const std::string& contract ) {
+      auto account  = act.find( "account" );
+      auto act_name = act.find( "name" );
+      if( !account || account->text != contract || !act_name || act_name->text != "logevent" ) return {};
+
+      auto receiver = trace.find( "receiver" );
+      if( auto receipt = trace.find( "receipt" ); !receiver && receipt ) receiver = receipt->find( "receiver" );
+      if( receiver && receiver->text != contract ) return {};
+
+      auto data = act.find( "data" );
+      if( data && data->kind == json::object_v ) {
+         logevent e;
+         e.event   = name( field( *data, "event" ).text );
+         e.project = name( field( *data, "project" ).text );
+         e.user    = name( field( *data, "user" ).text );
+         e.seconds = std::stoll( field( *data, "seconds" ).text );
+         e.amount  = std::stoll( field( *data, "amount" ).text );
+         e.pending = std::stoll( field( *data, "pending" ).text );
+         return e;
+      }
+      if( !data || data->kind != json::string_v ) data = act.find( "hex_data" );
+      if( !data ) throw std::runtime_error( "logevent without data" );
+      return unpack<logevent>( from_hex( data->text ) );
+   }
+
+   struct index_header {
+      char     magic[8];
+      uint64_t contract;
+      uint64_t capacity;   // buckets, a power of two
+      uint64_t size;       // buckets in use
+      uint64_t records;    // input records consumed
+      uint64_t events;     // logevent actions applied
+      uint64_t offset;     // input bytes consumed, up to the end of the last whole record
+      uint64_t device;     // st_dev and st_ino of the input
+      uint64_t inode;
+      uint64_t prefix;     // hash of the first min(offset, prefix_length) input bytes
+      char     input[256]; // input path as given, for messages
+   };
+
+   struct bucket {
+      uint64_t project;
+      uint64_t user;
+      uint32_t week;
+      uint32_t used;
+      int64_t  logged;     // seconds added to pending
+      int64_t  approved;   // seconds approved or paid by runpayroll
+      int64_t  declined;   // seconds declined
+      int64_t  paid;       // payments, in units of the project token
+      int64_t  deposited;
+      int64_t  withdrawn;
+      uint64_t events;
+   };
+
+   constexpr char     index_magic[8]   = { 'h', 'p', 'i', 'n', 'd', 'e', 'x', '3' };
+   constexpr uint64_t initial_capacity = 1 << 16;
+   constexpr uint64_t prefix_length    = 4096;
+
+   uint64_t bucket_hash( uint64_t project, uint64_t user, uint32_t week ) {
+      uint64_t h = project * 0x9e3779b97f4a7c15ull;
+      h ^= (user + 0x632be59bd9b4e019ull) * 0xbf58476d1ce4e5b9ull;
+      h ^= uint64_t( week ) * 0x94d049bb133111ebull;
+      h ^= h >> 31;
+      h *= 0xd6e8feb86659fd93ull;
+      return h ^ (h >> 32);
+   }
+
+   /**
+    * Open addressing hash table of buckets in a file mapped with MAP_SHARED, so the resident set
+    * stays with the page cache instead of growing with the history. It doubles into a new file
+    * (renamed over the old one) past 70% load.
+    */
+   class index_file {
+   public:
+      index_file( const std::string& path, name contract, bool rebuild, bool create_missing = true ) : _path( path ) {
+         struct stat st;
+         if( rebuild || (create_missing && ::stat( path.c_str(), &st ) != 0) ) {
+            create( path, initial_capacity );
+            header().contract = contract.value;
+            return;
+         }
+         _fd = ::open( path.c_str(), O_RDWR );
+         if( _fd < 0 || ::fstat( _fd, &st ) != 0 ) throw std::runtime_error( "can't open " + path + ": " + std::strerror( errno ) );
+         map( size_t( st.st_size ) );
+         if( _length >= sizeof(index_header::magic) && std::memcmp( header().magic, index_magic, sizeof(index_magic) - 1 ) == 0
+             && header().magic[7] != index_magic[7] ) {
+            throw std::runtime_error( path + " was written by another version of the indexer, ingest with --rebuild" );
+         }
+         if( _length < sizeof(index_header) || std::memcmp( header().magic, index_magic, sizeof(index_magic) ) != 0
+             || _length != sizeof(index_header) + header().capacity * sizeof(bucket) ) {
+            throw std::runtime_error( path + " is not an index" );
+         }
+         if( contract && header().contract != contract.value ) {
+            throw std::runtime_error( path + " indexes " + name( header().contract ).to_string() );
+         }
+      }
+
+      ~index_file() { close(); }
+
+      index_header& header() { return *reinterpret_cast<index_header*>( _base ); }
+
+      bucket* buckets() { return reinterpret_cast<bucket*>( _base + sizeof(index_header) ); }
+
+      bucket& find_or_insert( name project, name user, uint32_t week ) {
+         if( (header().size + 1) * 10 > header().capacity * 7 ) grow();
+
+         auto* b    = buckets();
+         auto  mask = header().capacity - 1;
+         for( auto i = bucket_hash( project.value, user.value, week ) & mask;; i = (i + 1) & mask ) {
+            if( !b[i].used ) {
+               b[i].project = project.value;
+               b[i].user    = user.value;
+               b[i].week    = week;
+               b[i].used    = 1;
+               header().size++;
+               return b[i];
+            }
+            if( b[i].project == project.value && b[i].user == user.value && b[i].week == week ) return b[i];
+         }
+      }
+
+      void sync() {
+         if( ::msync( _base, _length, MS_SYNC ) != 0 ) throw std::runtime_error( "can't sync " + _path );
+      }
+
+   private:
+      void create( const std::string& path, uint64_t capacity ) {
+         _fd = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+         if( _fd < 0 ) throw std::runtime_error( "can't create " + path + ": " + std::strerror( errno ) );
+         auto length = sizeof(index_header) + capacity * sizeof(bucket);
+         if( ::ftruncate( _fd, off_t( length ) ) != 0 ) throw std::runtime_error( "can't resize " + path );
+         map( length );
+         std::memcpy( header().magic, index_magic, sizeof(index_magic) );
+         header().capacity = capacity;
+      }
+
+      void map( size_t length ) {
+         auto base = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+         if( base == MAP_FAILED ) throw std::runtime_error( "can't map " + _path + ": " + std::strerror( errno ) );
+         _base   = static_cast<char*>( base );
+         _length = length;
+      }
+
+      void close() {
+         if( _base ) ::munmap( _base, _length );
+         if( _fd >= 0 ) ::close( _fd );
+         _base = nullptr;
+         _fd   = -1;
+      }
+
+      void grow() {
+         index_file next;
+         next._path = _path + ".grow";
+         next.create( next._path, header().capacity * 2 );
+
+         auto old = header();
+         next.header()          = old;
+         next.header().capacity = old.capacity * 2;
+         next.header().size     = 0;
+         for( uint64_t i = 0; i < old.capacity; ++i ) {
+            const auto& b = buckets()[i];
+            if( !b.used ) continue;
+            next.find_or_insert( name( b.project ), name( b.user ), b.week ) = b;
+         }
+         next.sync();
+         if( std::rename( next._path.c_str(), _path.c_str() ) != 0 ) throw std::runtime_error( "can't replace " + _path );
+
+         close();
+         std::swap( _fd, next._fd );
+         std::swap( _base, next._base );
+         std::swap( _length, next._length );
+      }
+
+      index_file() = default;
+
+      std::string _path;
+      int         _fd     = -1;
+      char*       _base   = nullptr;
+      size_t      _length = 0;
+   };
+
+   bool is_payment( name event ) {
+      return event == name( "approve" ) || event == name( "batchapprove" )
+          || event == name( "runpayroll" ) || event == name( "approveentry" );
+   }
+
+   bool is_decline( name event ) {
+      return event == name( "decline" ) || event == name( "declineentry" );
+   }
+
+   void apply( index_file& idx, uint32_t unix_seconds, const logevent& e ) {
+      auto& b = idx.find_or_insert( e.project, e.user, week_of( unix_seconds ) );
+      if( e.seconds > 0 ) {
+         b.logged += e.seconds;
+      } else if( is_payment( e.event ) ) {
+         b.approved -= e.seconds;
+         b.paid     += e.amount;
+      } else if( is_decline( e.event ) ) {
+         b.declined -= e.seconds;
+      } else if( e.event == name( "deposit" ) ) {
+         b.deposited += e.amount;
+      } else if( e.event == name( "withdraw" ) ) {
+         b.withdrawn += e.amount;
+      }
+      b.events++;
+      idx.header().events++;
+   }
+
+   void export_event( std::ostream* out, uint32_t unix_seconds, const logevent& e ) {
+      if( !out ) return;
+      auto bytes = pack( event_record{ block_timestamp( time_point_sec( unix_seconds ) ), e } );
+      out->write( bytes.data(), std::streamsize( bytes.size() ) );
+   }
+
+   struct ingest_result {
+      uint64_t records = 0;
+      uint64_t skipped = 0;
+      uint64_t events  = 0;
+   };
+
+   ingest_result ingest_jsonl( std::istream& in, index_file& idx, const std::string& contract, std::ostream* exported ) {
+      ingest_result result;
+      std::string line;
+      while( std::getline( in, line ) ) {
+         if( in.eof() ) {
+            // a line still being written; the next ingest starts from it
+            std::cerr << "ignoring a truncated record at the end of the input" << std::endl;
+            break;
+         }
+         if( line.find( "logevent" ) != std::string::npos ) {
+            for_each_action( parse_json( line ), nullptr, [&]( const json& trace, const json& act, const json* block_time ) {
+               auto e = read_logevent( trace, act, contract );
+               if( !e ) return;
+               if( !block_time ) throw std::runtime_error( "logevent without block_time" );
+               auto t = parse_block_time( block_time->text );
+               apply( idx, t, *e );
+               export_event( exported, t, *e );
+               ++result.events;
+            });
+         }
+         ++result.records;
+         idx.header().records++;
+         idx.header().offset += line.size() + 1;
+      }
+      return result;
+   }
+
+   ingest_result ingest_binary( std::istream& in, index_file& idx, std::ostream* exported ) {
+      ingest_result result;
+      char buf[event_record_size];
+      while( in.read( buf, sizeof(buf) ) ) {
+         auto r = unpack<event_record>( buf, sizeof(buf) );
+         auto t = to_unix_seconds( r.time );
+         apply( idx, t, r.event );
+         export_event( exported, t, r.event );
+         ++result.events;
+         ++result.records;
+         idx.header().records++;
+         idx.header().offset += sizeof(buf);
+      }
+      if( in.gcount() > 0 ) {
+         // a record still being written; the next ingest starts from it
+         std::cerr << "ignoring a truncated record at the end of the input" << std::endl;
+      }
+      return result;
+   }
+
+   // FNV-1a of the first min(length, prefix_length) bytes of `in`
+   uint64_t prefix_hash( std::istream& in, uint64_t length ) {
+      char buf[prefix_length];
+      in.clear();
+      in.seekg( 0 );
+      in.read( buf, std::streamsize( std::min( length, prefix_length ) ) );
+      uint64_t h = 0xcbf29ce484222325ull;
+      for( std::streamsize i = 0; i < in.gcount(); ++i ) {
+         h = (h ^ uint8_t( buf[i] )) * 0x100000001b3ull;
+      }
+      return h;
+   }
+
+   /**
+    * Positions `in` (nullptr for standard input) at the offset the index stopped at, after checking
+    * that it is the input the index was built from; an empty index takes `path` as its input.
+    */
+   void resume( index_file& idx, const std::string& path, std::ifstream* in ) {
+      auto& h = idx.header();
+      struct stat st{};
+      if( in && ::stat( path.c_str(), &st ) != 0 ) throw std::runtime_error( "can't stat " + path + ": " + std::strerror( errno ) );
+
+      if( h.offset == 0 ) {
+         h.device = in ? uint64_t( st.st_dev ) : 0;
+         h.inode  = in ? uint64_t( st.st_ino ) : 0;
+         std::snprintf( h.input, sizeof(h.input), "%s", path.c_str() );
+         return;
+      }
+
+      auto refuse = [&]( const std::string& why ) {
+         throw std::runtime_error( "the index continues " + std::string( h.input ) + " at byte " + std::to_string( h.offset )
+                                   + " but " + why + ", ingest with --rebuild to index it from the start" );
+      };
+      if( !in ) refuse( "standard input can't be checked" );
+      if( uint64_t( st.st_dev ) != h.device || uint64_t( st.st_ino ) != h.inode ) refuse( path + " is another file" );
+      if( uint64_t( st.st_size ) < h.offset ) refuse( path + " is shorter" );
+      if( prefix_hash( *in, h.offset ) != h.prefix ) refuse( path + " was rewritten" );
+      in->clear();
+      in->seekg( std::streamoff( h.offset ) );
+   }
+
+   std::string hours( int64_t seconds, bool in_seconds ) {
+      if( in_seconds ) return std::to_string( seconds );
+      char buf[32];
+      std::snprintf( buf, sizeof(buf), "%.2f", seconds / 3600.0 );
+      return buf;
+   }
+
+   void query( index_file& idx, name project, std::optional<name> user, uint32_t from, uint32_t to, bool in_seconds ) {
+      std::vector<const bucket*> rows;
+      auto* b = idx.buckets();
+      for( uint64_t i = 0; i < idx.header().capacity; ++i ) {
+         if( !b[i].used || b[i].project != project.value || b[i].week < from || b[i].week > to ) continue;
+         if( user && b[i].user != user->value ) continue;
+         rows.push_back( &b[i] );
+      }
+      std::sort( rows.begin(), rows.end(), []( const bucket* l, const bucket* r ) {
+         return std::tie( l->week, l->user ) < std::tie( r->week, r->user );
+      });
+
+      bucket total{};
+      const char* unit = in_seconds ? "_s" : "_h";
+      std::cout << "week\tstart\tuser\tlogged" << unit << "\tapproved" << unit << "\tdeclined" << unit
+                << "\tpaid\tdeposited\twithdrawn\tevents\n";
+      auto print = [&]( const std::string& week, const std::string& start, const std::string& who, const bucket& r ) {
+         std::cout << week << '\t' << start << '\t' << who << '\t'
+                   << hours( r.logged, in_seconds ) << '\t' << hours( r.approved, in_seconds ) << '\t' << hours( r.declined, in_seconds ) << '\t'
+                   << r.paid << '\t' << r.deposited << '\t' << r.withdrawn << '\t' << r.events << '\n';
+      };
+      for( auto r : rows ) {
+         print( std::to_string( r->week ), civil_date( int64_t( r->week ) * 7 - week_offset_days ), name( r->user ).to_string(), *r );
+         total.logged    += r->logged;
+         total.approved  += r->approved;
+         total.declined  += r->declined;
+         total.paid      += r->paid;
+         total.deposited += r->deposited;
+         total.withdrawn += r->withdrawn;
+         total.events    += r->events;
+      }
+      print( "total", "-", user ? user->to_string() : "-", total );
+   }
+
+   int usage() {
+      std::cerr << "usage: horuspay_indexer [--index <file>] [--contract <name>] [--binary] [--rebuild] [--export <file>] ingest <input>|-\n"
+                << "       horuspay_indexer [--index <file>] [--from <week>] [--to <week>] [--seconds] query <project> [<user>]" << std::endl;
+      return 2;
+   }
+
+} // namespace
+
+int main( int argc, char** argv ) {
+   std::string index_path = "horuspay.idx";
+   std::string contract   = "horuspay";
+   std::string export_file;
+   bool        binary     = false;
+   bool        rebuild    = false;
+   bool        in_seconds = false;
+   uint32_t    from       = 0;
+   uint32_t    to         = std::numeric_limits<uint32_t>::max();
+   std::vector<std::string> args;
+
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         std::string arg = argv[i];
+         if( arg == "--index" && i + 1 < argc )         index_path  = argv[++i];
+         else if( arg == "--contract" && i + 1 < argc ) contract    = argv[++i];
+         else if( arg == "--export" && i + 1 < argc )   export_file = argv[++i];
+         else if( arg == "--from" && i + 1 < argc )     from        = parse_week( argv[++i] );
+         else if( arg == "--to" && i + 1 < argc )       to          = parse_week( argv[++i] );
+         else if( arg == "--binary" )                   binary      = true;
+         else if( arg == "--rebuild" )                  rebuild     = true;
+         else if( arg == "--seconds" )                  in_seconds  = true;
+         else if( arg == "-" || arg[0] != '-' )         args.push_back( arg );
+         else return usage();
+      }
+      if( args.empty() ) return usage();
+
+      if( args[0] == "ingest" && args.size() == 2 ) {
+         index_file idx( index_path, name( contract ), rebuild );
+
+         std::ifstream file;
+         if( args[1] != "-" ) {
+            file.open( args[1], std::ios::binary );
+            if( !file ) throw std::runtime_error( "can't open " + args[1] );
+         }
+         std::istream& in = args[1] == "-" ? std::cin : file;
+         const auto skipped = idx.header().records;
+         resume( idx, args[1], args[1] == "-" ? nullptr : &file );
+
+         std::ofstream exported;
+         if( !export_file.empty() ) {
+            exported.open( export_file, std::ios::binary | (rebuild ? std::ios::trunc : std::ios::app) );
+            if( !exported ) throw std::runtime_error( "can't write " + export_file );
+         }
+         auto out = export_file.empty() ? nullptr : &exported;
+
+         auto begin  = std::chrono::steady_clock::now();
+         auto result = binary ? ingest_binary( in, idx, out ) : ingest_jsonl( in, idx, contract, out );
+         result.skipped = skipped;
+         if( args[1] != "-" ) idx.header().prefix = prefix_hash( file, idx.header().offset );
+         idx.sync();
+         double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+
+         std::cerr << "records " << result.records << " skipped " << result.skipped << " events " << result.events
+                   << " buckets " << idx.header().size << " seconds " << elapsed
+                   << " records/s " << uint64_t( elapsed > 0 ? result.records / elapsed : 0 ) << std::endl;
+      } else if( args[0] == "query" && (args.size() == 2 || args.size() == 3) ) {
+         index_file idx( index_path, name(), false, false );
+         std::optional<name> user;
+         if( args.size() == 3 ) user = name( args[2] );
+         query( idx, name( args[1] ), user, from, to, in_seconds );
+      } else {
+         return usage();
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
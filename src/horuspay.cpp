@@ -16,6 +16,20 @@ void horuspay::create(name project, name owner, extended_asset hourly_rate) {
    auto prj = _projects.find(project.value);
    eosio::check(prj == _projects.end(), "A project with that name already exists");
 
+   //Payments are credited per symbol code, refuse a second contract (or precision) for it here
+   //instead of failing every approval later
+   pay_symbol_table _symbols(_self, _self.value);
+   auto sym = _symbols.find(hourly_rate.quantity.symbol.code().raw());
+   if(sym == _symbols.end()) {
+      _symbols.emplace(_self, [&](auto& s){
+         s.symbol   = hourly_rate.quantity.symbol;
+         s.contract = hourly_rate.contract;
+      });
+   } else {
+      eosio::check(sym->contract == hourly_rate.contract && sym->symbol == hourly_rate.quantity.symbol,
+                   "symbol is already paid from another token contract");
+   }
+
    _projects.emplace(_self, [&](auto& p){
       p.name        = project;
       p.hourly_rate = hourly_rate;
@@ -23,19 +37,168 @@ void horuspay::create(name project, name owner, extended_asset hourly_rate) {
       p.balance.quantity.amount = 0;
    });
 
-   project_manager_table _project_managers(_self, _self.value);
+   project_manager_table _project_managers(_self, project.value);
    _project_managers.emplace(_self, [&](auto& pa){
-      pa.id       = _project_managers.available_primary_key();
       pa.manager  = owner;
-      pa.project  = project;
       pa.is_owner = true;
    });
 
+   allowed_token_table _tokens(_self, _self.value);
+   if(_tokens.find(hourly_rate.contract.value) == _tokens.end()) {
+      _tokens.emplace(_self, [&](auto& t){
+         t.contract = hourly_rate.contract;
+      });
+   }
+
+   project_stats_table _stats(_self, _self.value);
+   _stats.emplace(_self, [&](auto& st){
+      st.project    = project;
+      st.pending    = 0;
+      st.members    = 0;
+      st.managers   = 1;
+      st.clocked_in = 0;
+      st.liability  = asset(0, hourly_rate.quantity.symbol);
+   });
+
+   log_event(event_sink(), "create"_n, project, owner, 0, hourly_rate.quantity.amount, 0);
+}
+
+void horuspay::addtoken(name contract) {
+
+   require_auth(_self);
+
+   eosio::check(eosio::is_account(contract), "Invalid token account");
+
+   allowed_token_table _tokens(_self, _self.value);
+   eosio::check(_tokens.find(contract.value) == _tokens.end(), "token contract already allowed");
+
+   _tokens.emplace(_self, [&](auto& t){
+      t.contract = contract;
+   });
+}
+
+void horuspay::rmvtoken(name contract) {
+
+   require_auth(_self);
+
+   allowed_token_table _tokens(_self, _self.value);
+   auto tkn = _tokens.find(contract.value);
+   eosio::check(tkn != _tokens.end(), "token contract not allowed");
+
+   //Deposits of the projects paid from it would no longer be credited
+   pay_symbol_table _symbols(_self, _self.value);
+   for(const auto& sym : _symbols) {
+      eosio::check(sym.contract != contract, "token contract is used by a project");
+   }
+
+   _tokens.erase(tkn);
+}
+
+void horuspay::setsink(name sink) {
+
+   require_auth(_self);
+
+   eosio::check(sink == name() || eosio::is_account(sink), "sink must be a registered account");
+
+   config_singleton _config(_self, _self.value);
+   auto cfg = _config.get_or_default();
+   cfg.event_sink = sink;
+   _config.set(cfg, _self);
+}
+
+void horuspay::migrate(uint32_t max_rows) {
+
+   require_auth(_self);
+
+   eosio::check(max_rows > 0, "max_rows must be positive");
+
+   legacy_project_manager_table _legacy_managers(_self, _self.value);
+   legacy_project_user_table _legacy_users(_self, _self.value);
+   eosio::check(_legacy_managers.begin() != _legacy_managers.end() || _legacy_users.begin() != _legacy_users.end(),
+                "nothing to migrate");
+
+   //Stats of a project are rebuilt by its next action once its rows are in place
+   project_stats_table _stats(_self, _self.value);
+   auto reset_stats = [&](name project) {
+      auto st = _stats.find(project.value);
+      if(st != _stats.end()) _stats.erase(st);
+   };
+
+   //Projects created before the token allowlist keep receiving deposits
+   project_table _projects(_self, _self.value);
+   allowed_token_table _tokens(_self, _self.value);
+   pay_symbol_table _symbols(_self, _self.value);
+   auto allow_token = [&](name project) {
+      auto prj = _projects.find(project.value);
+      if(prj == _projects.end()) return;
+
+      const auto& rate = prj->hourly_rate;
+      if(_tokens.find(rate.contract.value) == _tokens.end()) {
+         _tokens.emplace(_self, [&](auto& t){
+            t.contract = rate.contract;
+         });
+      }
+      if(_symbols.find(rate.quantity.symbol.code().raw()) == _symbols.end()) {
+         _symbols.emplace(_self, [&](auto& sym){
+            sym.symbol   = rate.quantity.symbol;
+            sym.contract = rate.contract;
+         });
+      }
+   };
+
+   uint32_t rows = 0;
+   for(auto lm = _legacy_managers.begin(); lm != _legacy_managers.end() && rows < max_rows; ++rows) {
+      project_manager_table _project_managers(_self, lm->project.value);
+      eosio::check(_project_managers.find(lm->manager.value) == _project_managers.end(), "manager is already a manager of the project");
+
+      _project_managers.emplace(_self, [&](auto& m){
+         m.manager  = lm->manager;
+         m.is_owner = lm->is_owner;
+      });
+
+      reset_stats(lm->project);
+      allow_token(lm->project);
+      lm = _legacy_managers.erase(lm);
+   }
+
+   for(auto lu = _legacy_users.begin(); lu != _legacy_users.end() && rows < max_rows; ++rows) {
+      project_user_table _project_users(_self, lu->project.value);
+      eosio::check(_project_users.find(lu->user.value) == _project_users.end(), "the user is already a member of the project");
+
+      _project_users.emplace(_self, [&](auto& u){
+         u.user       = lu->user;
+         u.pending    = lu->pending;
+         u.rate       = lu->hourly_rate.quantity.amount;
+         u.carry      = 0;
+         u.last_clock = lu->last_clock;
+      });
+
+      reset_stats(lu->project);
+      allow_token(lu->project);
+      lu = _legacy_users.erase(lu);
+   }
+}
+
+//The arguments are only read from the action traces
+void horuspay::logevent(name, name, name, int64_t, int64_t, int64_t) {
+
+   require_auth(_self);
+
+   config_singleton _config(_self, _self.value);
+   auto sink = _config.get_or_default().event_sink;
+   if(sink != name() && sink != _self) {
+      eosio::require_recipient(sink);
+   }
 }
 
 void horuspay::on_transfer( name from, name to, asset quantity, const std::string& memo ) {
 
-   if(from == _self) return;
+   //Ignore outgoing transfers and anything that is not a deposit before loading project tables
+   if(from == _self || to != _self) return;
+   if(!is_project_memo(memo)) return;
+
+   allowed_token_table _tokens(_self, _self.value);
+   if(_tokens.find(get_first_receiver().value) == _tokens.end()) return;
 
    name project = name(memo);
    // print("on_transfer: [", memo, "][", project, "]");
@@ -44,10 +207,8 @@ void horuspay::on_transfer( name from, name to, asset quantity, const std::strin
    auto prj = _projects.find(project.value);
    eosio::check(prj != _projects.end(), "transfer project not found");
 
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   auto& pa = projmanager_inx.get(compute_key(from.value, project.value), "only project managers can deposit");
-   eosio::check(pa.project == project, "internal error");
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(from.value, "only project managers can deposit");
 
    //Valiate received token symbol with the one configured for the project
    eosio::check(quantity.symbol == prj->balance.quantity.symbol, "invalid deposit token");
@@ -57,6 +218,8 @@ void horuspay::on_transfer( name from, name to, asset quantity, const std::strin
    _projects.modify(prj, same_payer, [&](auto& p){
       p.balance.quantity += quantity;
    });
+
+   log_event(event_sink(), "deposit"_n, project, from, 0, quantity.amount, 0);
 }
 
 void horuspay::adduser(name project, name manager, name user) {
@@ -66,110 +229,199 @@ void horuspay::adduser(name project, name manager, name user) {
    project_table _projects(_self, _self.value);
    const auto& prj = _projects.get(project.value, "project not found");
 
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   auto& pa = projmanager_inx.get(compute_key(manager.value, project.value), "only project manager can add users");
+   project_manager_table _project_managers(_self, project.value);
+   auto& pa = _project_managers.get(manager.value, "only project manager can add users");
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu == projuser_inx.end(), "the user is already a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu = _project_users.find(user.value);
+   eosio::check(pu == _project_users.end(), "the user is already a member of the project");
    eosio::check(eosio::is_account(user), "user must be a registered account");
 
    _project_users.emplace(_self, [&](auto& u){
-      u.id          = _project_users.available_primary_key();
-      u.project     = project;
       u.user        = user;
       u.pending     = 0;
-      u.hourly_rate = prj.hourly_rate;
+      u.rate        = prj.hourly_rate.quantity.amount;
+      u.carry       = 0;
       u.last_clock  = decltype(u.last_clock)(0);
    });
+
+   update_stats(project, [&](auto& st){
+      st.members++;
+   });
+
+   log_event(event_sink(), "adduser"_n, project, user, 0, prj.hourly_rate.quantity.amount, 0);
 }
 
 void horuspay::removeuser(name project, name manager, name user) {
    
    require_auth(manager);
    
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   auto& pa = projmanager_inx.get(compute_key(manager.value, project.value), "only project admins can remove users");
-
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu != projuser_inx.end(), "the user is not member of the project");
+   project_manager_table _project_managers(_self, project.value);
+   auto& pa = _project_managers.get(manager.value, "only project admins can remove users");
+
+   project_user_table _project_users(_self, project.value);
+   auto pu = _project_users.find(user.value);
+   eosio::check(pu != _project_users.end(), "the user is not member of the project");
    eosio::check(pu->pending == 0, "the user has pending hours");
 
-   projuser_inx.erase(pu);
+   auto liability  = owed(*pu);
+   bool clocked_in = pu->last_clock.slot != 0;
+
+   _project_users.erase(pu);
+
+   update_stats(project, [&](auto& st){
+      st.members--;
+      st.liability.amount -= liability;
+      if(clocked_in) st.clocked_in--;
+   });
+
+   log_event(event_sink(), "removeuser"_n, project, user, 0, 0, 0);
 }
 
 void horuspay::addmanager(name project, name owner, name manager) {
 
    require_auth(owner);
    
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   auto pa = projmanager_inx.find(compute_key(owner.value, project.value));
-   eosio::check(pa != projmanager_inx.end() && pa->is_owner == true, "only project owner can add new managers");
+   project_manager_table _project_managers(_self, project.value);
+   auto pa = _project_managers.find(owner.value);
+   eosio::check(pa != _project_managers.end() && pa->is_owner == true, "only project owner can add new managers");
 
-   auto npa = projmanager_inx.find(compute_key(manager.value, project.value));
-   eosio::check(npa == projmanager_inx.end(), "manager is already a manager of the project");
+   auto npa = _project_managers.find(manager.value);
+   eosio::check(npa == _project_managers.end(), "manager is already a manager of the project");
    eosio::check(eosio::is_account(manager), "manager must be a registered account");
 
    _project_managers.emplace(_self, [&](auto& m){
-      m.id        = _project_managers.available_primary_key();
-      m.project   = project;
       m.manager   = manager;
       m.is_owner  = false;
    });
+
+   update_stats(project, [&](auto& st){
+      st.managers++;
+   });
+
+   log_event(event_sink(), "addmanager"_n, project, manager, 0, 0, 0);
 }
 
 void horuspay::rmvmanager(name project, name owner, name manager) {
    
    require_auth(owner);
    
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   auto pa = projmanager_inx.find(compute_key(owner.value, project.value));
-   eosio::check(pa != projmanager_inx.end() && pa->is_owner == true, "only project owner can remove managers");
+   project_manager_table _project_managers(_self, project.value);
+   auto pa = _project_managers.find(owner.value);
+   eosio::check(pa != _project_managers.end() && pa->is_owner == true, "only project owner can remove managers");
+
+   auto mgr = _project_managers.find(manager.value);
+   eosio::check(mgr != _project_managers.end(), "not a manager of the project");
 
-   auto mgr = projmanager_inx.find(compute_key(manager.value, project.value));
-   eosio::check(mgr != projmanager_inx.end(), "not a manager of the project");
+   _project_managers.erase(mgr);
+
+   update_stats(project, [&](auto& st){
+      st.managers--;
+   });
 
-   projmanager_inx.erase(mgr);
+   log_event(event_sink(), "rmvmanager"_n, project, manager, 0, 0, 0);
 }
 
 void horuspay::clockin(name project, name user) {
 
    require_auth(user);
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu_itr = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu_itr != projuser_inx.end(), "the user is not a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu_itr = _project_users.find(user.value);
+   eosio::check(pu_itr != _project_users.end(), "the user is not a member of the project");
+
+   bool was_clocked_in = pu_itr->last_clock.slot != 0;
 
    _project_users.modify(*pu_itr, same_payer, [&](auto& pu){
       pu.last_clock = eosio::current_block_time();
    });
+
+   if(!was_clocked_in) {
+      update_stats(project, [&](auto& st){
+         st.clocked_in++;
+      });
+   }
+
+   log_event(event_sink(), "clockin"_n, project, user, 0, 0, pu_itr->pending);
 }
 
 void horuspay::clockout(name project, name user, optional<string> description) {
    
    require_auth(user);
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu_itr = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu_itr != projuser_inx.end(), "the user is not a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu_itr = _project_users.find(user.value);
+   eosio::check(pu_itr != _project_users.end(), "the user is not a member of the project");
    eosio::check(pu_itr->last_clock.slot != 0, "must clockin first");
 
    auto total = eosio::time_point(eosio::current_block_time().to_time_point() - pu_itr->last_clock.to_time_point()).sec_since_epoch();
    eosio::check(total > 0, "time too small to account");
 
+   auto before = owed(*pu_itr);
+
+   append_entries(project, pu_itr->last_clock, {{user, total}});
+
    _project_users.modify(*pu_itr, same_payer, [&](auto& pu){
       pu.pending        += total;
       pu.last_clock.slot = 0;
    });
+
+   update_stats(project, [&](auto& st){
+      st.pending    += total;
+      st.clocked_in--;
+      st.liability.amount += owed(*pu_itr) - before;
+   });
+
+   log_event(event_sink(), "clockout"_n, project, user, total, 0, pu_itr->pending);
+}
+
+void horuspay::switchclock(name from, name to, name user, optional<string> description) {
+
+   require_auth(user);
+
+   eosio::check(from != to, "source and target projects must differ");
+
+   auto now = eosio::current_block_time();
+
+   project_user_table _from_users(_self, from.value);
+   auto from_itr = _from_users.find(user.value);
+   eosio::check(from_itr != _from_users.end(), "the user is not a member of the source project");
+   eosio::check(from_itr->last_clock.slot != 0, "must clockin first");
+
+   project_user_table _to_users(_self, to.value);
+   auto to_itr = _to_users.find(user.value);
+   eosio::check(to_itr != _to_users.end(), "the user is not a member of the target project");
+   eosio::check(to_itr->last_clock.slot == 0, "the user is already clocked in to the target project");
+
+   auto total = eosio::time_point(now.to_time_point() - from_itr->last_clock.to_time_point()).sec_since_epoch();
+   eosio::check(total > 0, "time too small to account");
+
+   auto before = owed(*from_itr);
+
+   append_entries(from, from_itr->last_clock, {{user, total}});
+
+   _from_users.modify(*from_itr, same_payer, [&](auto& pu){
+      pu.pending        += total;
+      pu.last_clock.slot = 0;
+   });
+
+   update_stats(from, [&](auto& st){
+      st.pending    += total;
+      st.clocked_in--;
+      st.liability.amount += owed(*from_itr) - before;
+   });
+
+   _to_users.modify(*to_itr, same_payer, [&](auto& pu){
+      pu.last_clock = now;
+   });
+
+   update_stats(to, [&](auto& st){
+      st.clocked_in++;
+   });
+
+   auto sink = event_sink();
+   log_event(sink, "switchclock"_n, from, user, total, 0, from_itr->pending);
+   log_event(sink, "switchclock"_n, to, user, 0, 0, to_itr->pending);
 }
 
 void horuspay::addtime(name project, name user, uint64_t seconds, optional<string> description, optional<name> manager) {
@@ -178,21 +430,419 @@ void horuspay::addtime(name project, name user, uint64_t seconds, optional<strin
 
    if(manager) {
       require_auth(*manager);
-      project_manager_table _project_managers(_self, _self.value);
-      auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-      projmanager_inx.get(compute_key(manager->value, project.value), "not a manager of the project");
+      project_manager_table _project_managers(_self, project.value);
+      _project_managers.get(manager->value, "not a manager of the project");
    } else {
       require_auth(user);
    }
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu_itr = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu_itr != projuser_inx.end(), "the user is not a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu_itr = _project_users.find(user.value);
+   eosio::check(pu_itr != _project_users.end(), "the user is not a member of the project");
+
+   auto before = owed(*pu_itr);
+
+   append_entries(project, eosio::current_block_time(), {{user, seconds}});
 
    _project_users.modify(*pu_itr, same_payer, [&](auto& pu){
       pu.pending += seconds;
    });
+
+   update_stats(project, [&](auto& st){
+      st.pending += seconds;
+      st.liability.amount += owed(*pu_itr) - before;
+   });
+
+   log_event(event_sink(), "addtime"_n, project, user, seconds, 0, pu_itr->pending);
+}
+
+void horuspay::addtimes(name project, name manager, std::vector<time_entry> entries) {
+
+   require_auth(manager);
+
+   eosio::check(entries.size() > 0, "nothing to add");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "not a manager of the project");
+
+   //Merge entries so every user row is modified only once, the ledger keeps them apart
+   std::map<name, uint64_t> totals;
+   std::vector<std::pair<name, uint64_t>> ledger;
+   for(const auto& e : entries) {
+      eosio::check(e.seconds > 0, "seconds must be positive");
+      totals[e.user] += e.seconds;
+      ledger.emplace_back(e.user, e.seconds);
+   }
+
+   project_user_table _project_users(_self, project.value);
+
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(const auto& t : totals) {
+      auto pu_itr = _project_users.find(t.first.value);
+      eosio::check(pu_itr != _project_users.end(), "the user is not a member of the project");
+
+      auto before = owed(*pu_itr);
+      _project_users.modify(*pu_itr, same_payer, [&](auto& pu){
+         pu.pending += t.second;
+      });
+
+      pending   += t.second;
+      liability += owed(*pu_itr) - before;
+
+      log_event(sink, "addtimes"_n, project, t.first, t.second, 0, pu_itr->pending);
+   }
+
+   append_entries(project, eosio::current_block_time(), ledger);
+
+   update_stats(project, [&](auto& st){
+      st.pending += pending;
+      st.liability.amount += liability;
+   });
+}
+
+void horuspay::setkey(name user, public_key key) {
+
+   require_auth(user);
+
+   //Users pay for their own key row, anyone can register one
+   user_key_table _keys(_self, _self.value);
+   auto uk = _keys.find(user.value);
+
+   if(uk == _keys.end()) {
+      _keys.emplace(user, [&](auto& k){
+         k.user  = user;
+         k.key   = key;
+         k.nonce = 0;
+      });
+   } else {
+      _keys.modify(uk, same_payer, [&](auto& k){
+         k.key = key;
+      });
+   }
+}
+
+void horuspay::addsigned(name project, name manager, std::vector<signed_timesheet> sheets) {
+
+   require_auth(manager);
+
+   eosio::check(sheets.size() > 0, "nothing to add");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "not a manager of the project");
+
+   user_key_table _keys(_self, _self.value);
+
+   //Verify every sheet and merge them per user, nonces must increase within the batch too
+   std::map<name, std::pair<uint64_t, uint64_t>> totals;
+   std::vector<std::pair<name, uint64_t>> ledger;
+   for(const auto& s : sheets) {
+      eosio::check(s.sheet.project == project, "timesheet is for another project");
+      eosio::check(s.sheet.seconds > 0, "seconds must be positive");
+
+      const auto& uk = _keys.get(s.sheet.user.value, "user has no registered key");
+
+      auto t = totals.find(s.sheet.user);
+      uint64_t last_nonce = t == totals.end() ? uk.nonce : t->second.second;
+      eosio::check(s.sheet.nonce > last_nonce, "timesheet nonce already used");
+
+      auto packed = eosio::pack(std::make_tuple(_self, s.sheet));
+      eosio::assert_recover_key(eosio::sha256(packed.data(), packed.size()), s.sig, uk.key);
+
+      auto& total = totals[s.sheet.user];
+      total.first += s.sheet.seconds;
+      total.second = s.sheet.nonce;
+      ledger.emplace_back(s.sheet.user, s.sheet.seconds);
+   }
+
+   project_user_table _project_users(_self, project.value);
+
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(const auto& t : totals) {
+      auto pu_itr = _project_users.find(t.first.value);
+      eosio::check(pu_itr != _project_users.end(), "the user is not a member of the project");
+
+      auto before = owed(*pu_itr);
+      _project_users.modify(*pu_itr, same_payer, [&](auto& pu){
+         pu.pending += t.second.first;
+      });
+
+      pending   += t.second.first;
+      liability += owed(*pu_itr) - before;
+
+      log_event(sink, "addsigned"_n, project, t.first, t.second.first, 0, pu_itr->pending);
+
+      _keys.modify(_keys.get(t.first.value), same_payer, [&](auto& k){
+         k.nonce = t.second.second;
+      });
+   }
+
+   append_entries(project, eosio::current_block_time(), ledger);
+
+   update_stats(project, [&](auto& st){
+      st.pending += pending;
+      st.liability.amount += liability;
+   });
+}
+
+void horuspay::commitperiod(name project, name manager, uint32_t period, checksum256 root, uint32_t entries, std::vector<period_total> totals) {
+
+   require_auth(manager);
+
+   eosio::check(entries > 0 && totals.size() > 0, "nothing to commit");
+   eosio::check(totals.size() <= entries, "more users than entries");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "not a manager of the project");
+
+   period_commit_table _periods(_self, project.value);
+   eosio::check(_periods.find(period) == _periods.end(), "period already committed");
+
+   //Merge totals so every user row is modified only once
+   std::map<name, uint64_t> merged;
+   for(const auto& t : totals) {
+      eosio::check(t.seconds > 0, "seconds must be positive");
+      merged[t.user] += t.seconds;
+   }
+
+   project_user_table _project_users(_self, project.value);
+
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(const auto& t : merged) {
+      auto pu_itr = _project_users.find(t.first.value);
+      eosio::check(pu_itr != _project_users.end(), "the user is not a member of the project");
+
+      auto before = owed(*pu_itr);
+      _project_users.modify(*pu_itr, same_payer, [&](auto& pu){
+         pu.pending += t.second;
+      });
+
+      pending   += t.second;
+      liability += owed(*pu_itr) - before;
+
+      log_event(sink, "commitperiod"_n, project, t.first, t.second, 0, pu_itr->pending);
+   }
+
+   _periods.emplace(_self, [&](auto& p){
+      p.period   = period;
+      p.root     = root;
+      p.entries  = entries;
+      p.seconds  = pending;
+      p.manager  = manager;
+      p.disputes = 0;
+   });
+
+   update_stats(project, [&](auto& st){
+      st.pending += pending;
+      st.liability.amount += liability;
+   });
+}
+
+void horuspay::dispute(name project, uint32_t period, name disputer, period_entry entry, uint32_t index, std::vector<checksum256> proof) {
+
+   require_auth(disputer);
+
+   if(disputer != entry.user) {
+      project_manager_table _project_managers(_self, project.value);
+      _project_managers.get(disputer.value, "only the user of the entry or a project manager can dispute");
+   }
+
+   period_commit_table _periods(_self, project.value);
+   const auto& pc = _periods.get(period, "period not committed");
+   eosio::check(index < pc.entries, "entry index out of range");
+
+   //Walk up the tree; the last node of an odd level is promoted without a sibling
+   auto hash = merkle_leaf(entry);
+   size_t next = 0;
+   for(uint32_t pos = index, count = pc.entries; count > 1; pos /= 2, count = (count + 1) / 2) {
+      if(pos % 2 == 0 && pos + 1 == count) continue;
+
+      eosio::check(next < proof.size(), "proof too short");
+      hash = pos % 2 == 0 ? merkle_node(hash, proof[next]) : merkle_node(proof[next], hash);
+      ++next;
+   }
+   eosio::check(next == proof.size(), "proof too long");
+   eosio::check(hash == pc.root, "entry not in period");
+
+   auto at = std::lower_bound(pc.disputed.begin(), pc.disputed.end(), index);
+   eosio::check(at == pc.disputed.end() || *at != index, "entry already disputed");
+   auto offset = at - pc.disputed.begin();
+
+   _periods.modify(pc, same_payer, [&](auto& p){
+      p.disputed.insert(p.disputed.begin() + offset, index);
+      p.disputes++;
+   });
+
+   log_event(event_sink(), "dispute"_n, project, entry.user, 0, period, 0);
+}
+
+void horuspay::approveentry(name project, name manager, std::vector<uint64_t> ids) {
+
+   require_auth(manager);
+
+   eosio::check(ids.size() > 0, "nothing to approve");
+
+   project_table _projects(_self, _self.value);
+   const auto& prj = _projects.get(project.value, "project not found");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can approve hours");
+
+   //Settle the entries and pay each user once for all of them
+   ledger_entry_table _entries(_self, project.value);
+   std::map<name, int64_t> totals;
+   for(auto id : ids) {
+      const auto& e = _entries.get(id, "entry not found");
+      eosio::check(e.status == entry_pending, "entry already settled");
+
+      _entries.modify(e, same_payer, [&](auto& le){
+         le.status = entry_approved;
+      });
+      totals[e.user] += e.seconds;
+   }
+
+   project_user_table _project_users(_self, project.value);
+
+   auto total = asset(0, prj.balance.quantity.symbol);
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(const auto& t : totals) {
+      auto pu = _project_users.find(t.first.value);
+      eosio::check(pu != _project_users.end(), "the user is not a member of the project");
+      eosio::check(t.second <= pu->pending, "0 < approve <= pending");
+
+      auto pay = compute_payment(pu->rate, t.second, pu->carry, pay_rounding);
+      eosio::check(pay.amount >= 0, "payment must not be negative");
+      auto payment = asset(pay.amount, prj.balance.quantity.symbol);
+
+      auto before = owed(*pu);
+      _project_users.modify(pu, same_payer, [&](auto& p){
+         p.pending -= t.second;
+         p.carry    = pay.remainder;
+      });
+
+      if(payment.amount > 0) {
+         credit(t.first, extended_asset(payment, prj.balance.contract));
+      }
+      total     += payment;
+      pending   += t.second;
+      liability += owed(*pu) - before;
+
+      log_event(sink, "approveentry"_n, project, t.first, -t.second, payment.amount, pu->pending);
+   }
+
+   eosio::check(prj.balance.quantity >= total, "not enough funds");
+
+   _projects.modify(prj, same_payer, [&](auto& p) {
+      p.balance.quantity -= total;
+   });
+
+   update_stats(project, [&](auto& st){
+      st.pending -= pending;
+      st.liability.amount += liability;
+   });
+}
+
+void horuspay::declineentry(name project, name manager, std::vector<uint64_t> ids) {
+
+   require_auth(manager);
+
+   eosio::check(ids.size() > 0, "nothing to decline");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can decline hours");
+
+   ledger_entry_table _entries(_self, project.value);
+   std::map<name, int64_t> totals;
+   for(auto id : ids) {
+      const auto& e = _entries.get(id, "entry not found");
+      eosio::check(e.status == entry_pending, "entry already settled");
+
+      _entries.modify(e, same_payer, [&](auto& le){
+         le.status = entry_declined;
+      });
+      totals[e.user] += e.seconds;
+   }
+
+   project_user_table _project_users(_self, project.value);
+
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(const auto& t : totals) {
+      auto pu = _project_users.find(t.first.value);
+      eosio::check(pu != _project_users.end(), "the user is not a member of the project");
+      eosio::check(t.second <= pu->pending, "0 < decline <= pending");
+
+      auto before = owed(*pu);
+      _project_users.modify(pu, same_payer, [&](auto& p){
+         p.pending -= t.second;
+      });
+
+      pending   += t.second;
+      liability += owed(*pu) - before;
+
+      log_event(sink, "declineentry"_n, project, t.first, -t.second, 0, pu->pending);
+   }
+
+   update_stats(project, [&](auto& st){
+      st.pending -= pending;
+      st.liability.amount += liability;
+   });
+}
+
+void horuspay::compact(name project, name manager, uint32_t days, uint32_t max_rows) {
+
+   require_auth(manager);
+
+   eosio::check(max_rows > 0, "max_rows must be positive");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can compact entries");
+
+   auto now    = eosio::current_block_time().to_time_point().sec_since_epoch();
+   auto cutoff = now > uint64_t(days) * 86400 ? now - uint64_t(days) * 86400 : 0;
+
+   ledger_entry_table _entries(_self, project.value);
+   auto by_status = _entries.get_index<"bystatus"_n>();
+   entry_rollup_table _rollups(_self, project.value);
+   auto by_user_period = _rollups.get_index<"byuserperiod"_n>();
+
+   //Only settled entries are visited, oldest start first; pending entries stay in the ledger
+   //until they are settled
+   uint32_t rows = 0;
+   for(auto e = by_status.lower_bound(settled_entry_key(block_timestamp(), 0)); e != by_status.end() && rows < max_rows; ++rows) {
+      auto start = e->start.to_time_point().sec_since_epoch();
+      if(start >= cutoff) break;
+
+      uint32_t period = week_of(start);
+      auto ru = by_user_period.find(user_period_key(e->user, period));
+      if(ru == by_user_period.end()) {
+         _rollups.emplace(_self, [&](auto& r){
+            r.id       = _rollups.available_primary_key();
+            r.user     = e->user;
+            r.period   = period;
+            r.approved = e->status == entry_approved ? e->seconds : 0;
+            r.declined = e->status == entry_declined ? e->seconds : 0;
+            r.entries  = 1;
+         });
+      } else {
+         by_user_period.modify(ru, same_payer, [&](auto& r){
+            (e->status == entry_approved ? r.approved : r.declined) += e->seconds;
+            r.entries++;
+         });
+      }
+
+      e = by_status.erase(e);
+   }
+
+   log_event(event_sink(), "compact"_n, project, manager, 0, rows, 0);
 }
 
 void horuspay::approve(name project, name manager, name user, optional<int64_t> seconds) {
@@ -202,14 +852,12 @@ void horuspay::approve(name project, name manager, name user, optional<int64_t>
    project_table _projects(_self, _self.value);
    const auto& prj = _projects.get(project.value, "project not found");
 
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   projmanager_inx.get(compute_key(manager.value, project.value), "only managers can approve hours");
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can approve hours");
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu != projuser_inx.end(), "the user is not a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu = _project_users.find(user.value);
+   eosio::check(pu != _project_users.end(), "the user is not a member of the project");
 
    int64_t secs_to_approve = pu->pending;
    if(seconds) {
@@ -217,46 +865,219 @@ void horuspay::approve(name project, name manager, name user, optional<int64_t>
       secs_to_approve = *seconds;
    }
 
-   projuser_inx.modify(pu, same_payer, [&](auto& p){
+   auto pay = compute_payment(pu->rate, secs_to_approve, pu->carry, pay_rounding);
+   eosio::check(pay.amount >= 0, "payment must not be negative");
+   auto payment = asset(pay.amount, prj.balance.quantity.symbol);
+   eosio::check(prj.balance.quantity >= payment, "not enough funds");
+
+   auto before = owed(*pu);
+   _project_users.modify(pu, same_payer, [&](auto& p){
       p.pending -= secs_to_approve;
+      p.carry    = pay.remainder;
    });
 
-   double total_hours = double(secs_to_approve)/double(3600);
+   settle_entries(project, user, secs_to_approve, entry_approved);
 
-   auto q = pu->hourly_rate.quantity;
-   auto payment = asset(int64_t(double(q.amount)*total_hours), q.symbol);
-   eosio::check(prj.balance.quantity >= payment, "not enough funds");
+   update_stats(project, [&](auto& st){
+      st.pending -= secs_to_approve;
+      st.liability.amount += owed(*pu) - before;
+   });
 
-   {
-      std::string memo("horuspay");
-      transfer_action transfer_act{ prj.balance.contract, { _self, active_permission } };
-      transfer_act.send( _self, user, payment, memo );
+   if(payment.amount > 0) {
+      credit(user, extended_asset(payment, prj.balance.contract));
    }
 
    _projects.modify(prj, same_payer, [&](auto& p) {
       p.balance.quantity -= payment;
    });
 
+   log_event(event_sink(), "approve"_n, project, user, -secs_to_approve, payment.amount, pu->pending);
+}
+
+void horuspay::batchapprove(name project, name manager, std::vector<approval> approvals) {
+
+   require_auth(manager);
+
+   eosio::check(approvals.size() > 0, "nothing to approve");
+
+   project_table _projects(_self, _self.value);
+   const auto& prj = _projects.get(project.value, "project not found");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can approve hours");
+
+   project_user_table _project_users(_self, project.value);
+
+   auto total = asset(0, prj.balance.quantity.symbol);
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(const auto& a : approvals) {
+      auto pu = _project_users.find(a.user.value);
+      eosio::check(pu != _project_users.end(), "the user is not a member of the project");
+
+      int64_t secs_to_approve = pu->pending;
+      if(a.seconds) {
+         eosio::check(a.seconds > 0 && a.seconds <= secs_to_approve, "0 < approve <= pending");
+         secs_to_approve = *a.seconds;
+      }
+
+      auto pay = compute_payment(pu->rate, secs_to_approve, pu->carry, pay_rounding);
+      eosio::check(pay.amount >= 0, "payment must not be negative");
+      auto payment = asset(pay.amount, prj.balance.quantity.symbol);
+
+      auto before = owed(*pu);
+      _project_users.modify(pu, same_payer, [&](auto& p){
+         p.pending -= secs_to_approve;
+         p.carry    = pay.remainder;
+      });
+
+      settle_entries(project, a.user, secs_to_approve, entry_approved);
+
+      if(payment.amount > 0) {
+         credit(a.user, extended_asset(payment, prj.balance.contract));
+      }
+      total     += payment;
+      pending   += secs_to_approve;
+      liability += owed(*pu) - before;
+
+      log_event(sink, "batchapprove"_n, project, a.user, -secs_to_approve, payment.amount, pu->pending);
+   }
+
+   //Solvency is checked once against the whole batch
+   eosio::check(prj.balance.quantity >= total, "not enough funds");
+
+   _projects.modify(prj, same_payer, [&](auto& p) {
+      p.balance.quantity -= total;
+   });
+
+   update_stats(project, [&](auto& st){
+      st.pending -= pending;
+      st.liability.amount += liability;
+   });
+}
+
+void horuspay::runpayroll(name project, name manager, uint32_t max_rows) {
+
+   require_auth(manager);
+
+   eosio::check(max_rows > 0, "max_rows must be positive");
+
+   project_table _projects(_self, _self.value);
+   const auto& prj = _projects.get(project.value, "project not found");
+
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can approve hours");
+
+   payroll_cursor_singleton _cursor(_self, project.value);
+   auto cursor = _cursor.get_or_default();
+
+   project_user_table _project_users(_self, project.value);
+   auto pu = _project_users.lower_bound(cursor.next_user.value);
+
+   auto total = asset(0, prj.balance.quantity.symbol);
+   int64_t pending = 0;
+   int64_t liability = 0;
+   auto sink = event_sink();
+   for(uint32_t rows = 0; pu != _project_users.end() && rows < max_rows; ++rows, ++pu) {
+      if(pu->pending == 0) continue;
+
+      auto pay = compute_payment(pu->rate, pu->pending, pu->carry, pay_rounding);
+      eosio::check(pay.amount >= 0, "payment must not be negative");
+      auto payment = asset(pay.amount, prj.balance.quantity.symbol);
+
+      auto seconds = pu->pending;
+      pending += seconds;
+      auto before = owed(*pu);
+      _project_users.modify(pu, same_payer, [&](auto& p){
+         p.pending = 0;
+         p.carry   = pay.remainder;
+      });
+
+      settle_entries(project, pu->user, seconds, entry_approved);
+
+      if(payment.amount > 0) {
+         credit(pu->user, extended_asset(payment, prj.balance.contract));
+      }
+      total     += payment;
+      liability += owed(*pu) - before;
+
+      log_event(sink, "runpayroll"_n, project, pu->user, -seconds, payment.amount, 0);
+   }
+
+   eosio::check(prj.balance.quantity >= total, "not enough funds");
+
+   _projects.modify(prj, same_payer, [&](auto& p) {
+      p.balance.quantity -= total;
+   });
+
+   update_stats(project, [&](auto& st){
+      st.pending -= pending;
+      st.liability.amount += liability;
+   });
+
+   //Keep the cursor until the whole project has been visited
+   if(pu == _project_users.end()) {
+      _cursor.remove();
+   } else {
+      _cursor.set(payroll_cursor{pu->user}, _self);
+   }
+}
+
+void horuspay::withdraw(name user, asset quantity) {
+
+   require_auth(user);
+
+   eosio::check(quantity.is_valid() && quantity.amount > 0, "must withdraw positive quantity");
+
+   account_table _accounts(_self, user.value);
+   auto acc = _accounts.find(quantity.symbol.code().raw());
+   eosio::check(acc != _accounts.end(), "no balance to withdraw");
+   eosio::check(acc->balance.symbol == quantity.symbol, "symbol precision mismatch");
+   eosio::check(acc->balance >= quantity, "overdrawn balance");
+
+   name contract = acc->contract;
+   if(acc->balance == quantity) {
+      _accounts.erase(acc);
+   } else {
+      _accounts.modify(acc, same_payer, [&](auto& a){
+         a.balance -= quantity;
+      });
+   }
+
+   log_event(event_sink(), "withdraw"_n, name(), user, 0, quantity.amount, 0);
+
+   std::string memo("horuspay");
+   transfer_action transfer_act{ contract, { _self, active_permission } };
+   transfer_act.send( _self, user, quantity, memo );
 }
 
 void horuspay::decline(name project, name manager, name user, int64_t seconds) {
    
    require_auth(manager);
 
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   projmanager_inx.get(compute_key(manager.value, project.value), "only managers can decline hours");
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can decline hours");
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu != projuser_inx.end(), "the user is not a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu = _project_users.find(user.value);
+   eosio::check(pu != _project_users.end(), "the user is not a member of the project");
 
    eosio::check(seconds > 0 && seconds <= pu->pending, "0 < decline <= pending");
    
-   projuser_inx.modify(pu, same_payer, [&](auto& p){
+   auto before = owed(*pu);
+   _project_users.modify(pu, same_payer, [&](auto& p){
       p.pending  -= seconds;
    });
+
+   settle_entries(project, user, seconds, entry_declined);
+
+   update_stats(project, [&](auto& st){
+      st.pending -= seconds;
+      st.liability.amount += owed(*pu) - before;
+   });
+
+   log_event(event_sink(), "decline"_n, project, user, -seconds, 0, pu->pending);
 }
 
 void horuspay::setuserrate(name project, name manager, name user, extended_asset hourly_rate) {
@@ -265,21 +1086,181 @@ void horuspay::setuserrate(name project, name manager, name user, extended_asset
    project_table _projects(_self, _self.value);
    const auto& prj = _projects.get(project.value, "project not found");
 
+   eosio::check(hourly_rate.quantity.amount > 0, "Hourly rate must be positive");
    eosio::check(prj.hourly_rate.contract == hourly_rate.contract &&
       prj.hourly_rate.quantity.symbol == hourly_rate.quantity.symbol, "hourly rate asset/contract should be the same as project");
       
-   project_manager_table _project_managers(_self, _self.value);
-   auto projmanager_inx = _project_managers.get_index<"bymgr"_n>();
-   projmanager_inx.get(compute_key(manager.value, project.value), "only managers can change user hourly rate");
+   project_manager_table _project_managers(_self, project.value);
+   _project_managers.get(manager.value, "only managers can change user hourly rate");
 
-   project_user_table _project_users(_self, _self.value);
-   auto projuser_inx = _project_users.get_index<"byusr"_n>();
-   auto pu = projuser_inx.find(compute_key(user.value, project.value));
-   eosio::check(pu != projuser_inx.end(), "the user is not a member of the project");
+   project_user_table _project_users(_self, project.value);
+   auto pu = _project_users.find(user.value);
+   eosio::check(pu != _project_users.end(), "the user is not a member of the project");
 
-   projuser_inx.modify(pu, same_payer, [&](auto& p){
-      p.hourly_rate = hourly_rate;
+   auto before = owed(*pu);
+   _project_users.modify(pu, same_payer, [&](auto& p){
+      p.rate = hourly_rate.quantity.amount;
+   });
+
+   update_stats(project, [&](auto& st){
+      st.liability.amount += owed(*pu) - before;
    });
+
+   log_event(event_sink(), "setuserrate"_n, project, user, 0, hourly_rate.quantity.amount, pu->pending);
 }
 
+void horuspay::credit(name user, const extended_asset& amount) {
+
+   account_table _accounts(_self, user.value);
+   auto acc = _accounts.find(amount.quantity.symbol.code().raw());
+
+   if(acc == _accounts.end()) {
+      _accounts.emplace(_self, [&](auto& a){
+         a.balance  = amount.quantity;
+         a.contract = amount.contract;
+      });
+   } else {
+      eosio::check(acc->contract == amount.contract, "user balance for this symbol is held in another token contract");
+      _accounts.modify(acc, same_payer, [&](auto& a){
+         a.balance += amount.quantity;
+      });
+   }
 }
+
+void horuspay::rebuild_stats(name project) {
+
+   project_table _projects(_self, _self.value);
+   const auto& prj = _projects.get(project.value, "project not found");
+
+   project_stats st;
+   st.project    = project;
+   st.pending    = 0;
+   st.members    = 0;
+   st.managers   = 0;
+   st.clocked_in = 0;
+   st.liability  = asset(0, prj.hourly_rate.quantity.symbol);
+
+   project_user_table _project_users(_self, project.value);
+   for(const auto& pu : _project_users) {
+      st.members++;
+      st.pending          += pu.pending;
+      st.liability.amount += owed(pu);
+      if(pu.last_clock.slot != 0) st.clocked_in++;
+   }
+
+   project_manager_table _project_managers(_self, project.value);
+   for(auto itr = _project_managers.begin(); itr != _project_managers.end(); ++itr) {
+      st.managers++;
+   }
+
+   project_stats_table _stats(_self, _self.value);
+   _stats.emplace(_self, [&](auto& s){
+      s = st;
+   });
+}
+
+name horuspay::event_sink() {
+
+   config_singleton _config(_self, _self.value);
+   return _config.get_or_default().event_sink;
+}
+
+void horuspay::log_event(name sink, name event, name project, name user, int64_t seconds, int64_t amount, int64_t pending) {
+
+   if(sink == name()) return;
+
+   logevent_action log{ _self, { _self, active_permission } };
+   log.send(event, project, user, seconds, amount, pending);
+}
+
+void horuspay::append_entries(name project, block_timestamp start, const std::vector<std::pair<name, uint64_t>>& entries) {
+
+   ledger_state_singleton _ledger(_self, project.value);
+   auto state = _ledger.get_or_default();
+
+   ledger_entry_table _entries(_self, project.value);
+   for(const auto& e : entries) {
+      _entries.emplace(_self, [&](auto& le){
+         le.id      = state.next_id++;
+         le.user    = e.first;
+         le.seconds = e.second;
+         le.start   = start;
+         le.status  = entry_pending;
+      });
+   }
+
+   _ledger.set(state, _self);
+}
+
+void horuspay::settle_entries(name project, name user, uint64_t seconds, entry_status status) {
+
+   ledger_entry_table _entries(_self, project.value);
+   auto by_status = _entries.get_index<"bystatus"_n>();
+
+   //Pending entries of a user are in id order, the order they were recorded in. Pending seconds
+   //without entries (committed periods, rows from before the ledger) are left to the counters
+   auto last = pending_entry_key(user, (uint64_t(1) << 63) - 1);
+   auto e = by_status.lower_bound(pending_entry_key(user, 0));
+   while(seconds > 0 && e != by_status.end() && e->by_status() <= last) {
+      auto next = e;
+      ++next;
+
+      if(e->seconds <= seconds) {
+         seconds -= e->seconds;
+         by_status.modify(e, same_payer, [&](auto& le){
+            le.status = status;
+         });
+      } else {
+         //The settled part becomes an entry of its own, the rest stays pending
+         ledger_state_singleton _ledger(_self, project.value);
+         auto state = _ledger.get_or_default();
+
+         _entries.emplace(_self, [&](auto& le){
+            le.id      = state.next_id++;
+            le.user    = user;
+            le.seconds = seconds;
+            le.start   = e->start;
+            le.status  = status;
+         });
+         by_status.modify(e, same_payer, [&](auto& le){
+            le.seconds -= seconds;
+         });
+
+         _ledger.set(state, _self);
+         seconds = 0;
+      }
+
+      e = next;
+   }
+}
+
+checksum256 horuspay::merkle_leaf(const period_entry& entry) {
+
+   auto packed = eosio::pack(entry);
+   packed.insert(packed.begin(), char(0));
+   return eosio::sha256(packed.data(), packed.size());
+}
+
+checksum256 horuspay::merkle_node(const checksum256& left, const checksum256& right) {
+
+   std::array<char, 65> buffer;
+   auto l = left.extract_as_byte_array();
+   auto r = right.extract_as_byte_array();
+
+   buffer[0] = 1;
+   std::copy(l.begin(), l.end(), buffer.begin() + 1);
+   std::copy(r.begin(), r.end(), buffer.begin() + 33);
+   return eosio::sha256(buffer.data(), buffer.size());
+}
+
+bool horuspay::is_project_memo(const std::string& memo) {
+
+   if(memo.empty() || memo.size() > 12) return false;
+
+   for(char c : memo) {
+      if(!((c >= 'a' && c <= 'z') || (c >= '1' && c <= '5') || c == '.')) return false;
+   }
+   return true;
+}
+
+}
\ No newline at end of file
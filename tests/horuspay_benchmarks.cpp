@@ -0,0 +1,705 @@
+#include "horuspay_tester.hpp"
+
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+
+// Per-action cost report.
+//
+// Disabled by default, run it with:
+//    unit_test --run_test=horuspay_benchmarks
+//
+// HORUSPAY_BENCH_ITERATIONS  transactions per action (default 50)
+// HORUSPAY_BENCH_CSV         output file (default horuspay_benchmarks.csv)
+// HORUSPAY_BENCH_THRESHOLDS  optional file with `action,metric,max` lines; the run fails when
+//                            the p95 of a metric is above max (metrics: elapsed_us, cpu_us,
+//                            net_bytes, ram_bytes)
+//
+// Cost versus table size, also disabled by default:
+//    unit_test --run_test=horuspay_scaling
+//
+// HORUSPAY_SCALE_SIZES       comma separated membership counts (default 1000,10000,100000)
+// HORUSPAY_SCALE_PROBES      measured transactions per action and size (default 20)
+// HORUSPAY_SCALE_CSV         output file (default horuspay_scaling.csv)
+//
+// Random mixed load with conservation checks after every step, runs with the regular tests:
+//    unit_test --run_test=horuspay_load
+//
+// HORUSPAY_LOAD_STEPS        actions to push (default 300)
+// HORUSPAY_LOAD_SEED         random seed (default 1)
+// HORUSPAY_LOAD_PROJECTS     maximum number of projects (default 8)
+// HORUSPAY_LOAD_USERS        size of the user pool (default 16)
+// HORUSPAY_LOAD_CSV          optional output file with the cost percentiles per action
+
+struct cost_samples {
+   vector<int64_t> elapsed_us;
+   vector<int64_t> cpu_us;
+   vector<int64_t> net_bytes;
+   vector<int64_t> ram_bytes;
+};
+
+struct horuspay_bench_tester : horuspay_tester {
+
+   std::map<string, cost_samples> samples;
+
+   static uint32_t env_uint( const char* var, uint32_t def ) {
+      const char* value = std::getenv(var);
+      return value ? uint32_t(std::stoul(value)) : def;
+   }
+
+   static string env_string( const char* var, const string& def ) {
+      const char* value = std::getenv(var);
+      return value ? string(value) : def;
+   }
+
+   // prefix followed by `i` written with the letters a-p, always a valid account name
+   static account_name bench_name( const string& prefix, uint32_t i ) {
+      string suffix;
+      do {
+         suffix.insert(suffix.begin(), char('a' + (i & 0xf)));
+         i >>= 4;
+      } while( i );
+      return account_name(prefix + suffix);
+   }
+
+   // Takes the costs of the last pushed transaction
+   void record( const string& action ) {
+      BOOST_REQUIRE(last_tx_trace);
+      const auto& trace = *last_tx_trace;
+
+      int64_t ram = 0;
+      for( const auto& at : trace.action_traces ) {
+         for( const auto& d : at.account_ram_deltas ) {
+            if( d.account == ME ) ram += d.delta;
+         }
+      }
+
+      auto& s = samples[action];
+      s.elapsed_us.push_back( trace.elapsed.count() );
+      s.cpu_us.push_back( trace.receipt ? trace.receipt->cpu_usage_us : 0 );
+      s.net_bytes.push_back( int64_t(trace.net_usage) );
+      s.ram_bytes.push_back( ram );
+   }
+
+   // nearest-rank percentile
+   static int64_t percentile( vector<int64_t> values, uint32_t p ) {
+      if( values.empty() ) return 0;
+      std::sort(values.begin(), values.end());
+      size_t rank = (p * values.size() + 99) / 100;
+      return values[ std::max<size_t>(rank, 1) - 1 ];
+   }
+
+   static const vector<int64_t>& metric( const cost_samples& s, const string& name ) {
+      if( name == "elapsed_us" ) return s.elapsed_us;
+      if( name == "cpu_us" )     return s.cpu_us;
+      if( name == "net_bytes" )  return s.net_bytes;
+      BOOST_REQUIRE_EQUAL( name, "ram_bytes" );
+      return s.ram_bytes;
+   }
+
+   void write_csv( const string& path ) const {
+      std::ofstream out(path);
+      BOOST_REQUIRE(out.good());
+      out << "action,metric,samples,p50,p90,p95,p99,max" << std::endl;
+      for( const auto& entry : samples ) {
+         for( const auto& m : {"elapsed_us", "cpu_us", "net_bytes", "ram_bytes"} ) {
+            const auto& values = metric(entry.second, m);
+            out << entry.first << "," << m << "," << values.size()
+                << "," << percentile(values, 50) << "," << percentile(values, 90)
+                << "," << percentile(values, 95) << "," << percentile(values, 99)
+                << "," << percentile(values, 100) << std::endl;
+         }
+      }
+   }
+
+   void check_thresholds( const string& path ) const {
+      std::ifstream in(path);
+      BOOST_REQUIRE_MESSAGE( in.good(), "can't open thresholds file " << path );
+
+      string line;
+      while( std::getline(in, line) ) {
+         if( line.empty() || line[0] == '#' ) continue;
+
+         std::stringstream ss(line);
+         string action, name, max;
+         std::getline(ss, action, ',');
+         std::getline(ss, name, ',');
+         std::getline(ss, max, ',');
+
+         auto itr = samples.find(action);
+         BOOST_REQUIRE_MESSAGE( itr != samples.end(), "no samples for action " << action );
+
+         auto p95 = percentile(metric(itr->second, name), 95);
+         BOOST_CHECK_MESSAGE( p95 <= std::stoll(max), action << " " << name << " p95 " << p95 << " > " << max );
+      }
+   }
+};
+
+BOOST_AUTO_TEST_SUITE(horuspay_benchmarks, * boost::unit_test::disabled())
+
+BOOST_FIXTURE_TEST_CASE( action_costs, horuspay_bench_tester ) try {
+
+   const uint32_t iterations = env_uint("HORUSPAY_BENCH_ITERATIONS", 50);
+   const auto rate      = extended_asset(asset::from_string("10.0000 USD"), N(eosio.token));
+   const auto user_rate = extended_asset(asset::from_string("12.0000 USD"), N(eosio.token));
+
+   create_account_with_resources(N(own1), system_account_name);
+   for( uint32_t i = 0; i < iterations; ++i ) {
+      create_account_with_resources(bench_name("usr", i), system_account_name);
+   }
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("10000000.0000 USD"));
+   issue(name("own1"), asset::from_string("1000000.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(bench), N(own1), rate));
+
+   for( uint32_t i = 0; i < iterations; ++i ) {
+      auto user = bench_name("usr", i);
+
+      BOOST_REQUIRE_EQUAL( success()
+         , create(bench_name("prj", i), N(own1), rate));
+      record("create");
+
+      transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "bench" );
+      record("on_transfer");
+
+      BOOST_REQUIRE_EQUAL( success()
+         , adduser(N(bench), N(own1), user));
+      record("adduser");
+
+      BOOST_REQUIRE_EQUAL( success()
+         , clockin(N(bench), user));
+      record("clockin");
+
+      produce_blocks(2);
+
+      BOOST_REQUIRE_EQUAL( success()
+         , clockout(N(bench), user, {}));
+      record("clockout");
+
+      BOOST_REQUIRE_EQUAL( success()
+         , addtime(N(bench), user, 3600, {}, {}));
+      record("addtime");
+
+      BOOST_REQUIRE_EQUAL( success()
+         , decline(N(bench), N(own1), user, 600));
+      record("decline");
+
+      BOOST_REQUIRE_EQUAL( success()
+         , setuserrate(N(bench), N(own1), user, user_rate));
+      record("setuserrate");
+
+      BOOST_REQUIRE_EQUAL( success()
+         , approve(N(bench), N(own1), user, {}));
+      record("approve");
+   }
+
+   const auto csv = env_string("HORUSPAY_BENCH_CSV", "horuspay_benchmarks.csv");
+   write_csv(csv);
+   BOOST_TEST_MESSAGE( "horuspay benchmark written to " << csv );
+
+   const auto thresholds = env_string("HORUSPAY_BENCH_THRESHOLDS", "");
+   if( !thresholds.empty() ) {
+      check_thresholds(thresholds);
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(horuspay_scaling, * boost::unit_test::disabled())
+
+// Fills the scope of a probe project with memberships and measures adduser, addtime, approve
+// and removeuser on that project at every size. Filler rows are written straight to the chain
+// database since adduser needs an account per member; probes use `pool` real accounts.
+BOOST_FIXTURE_TEST_CASE( cost_vs_table_size, horuspay_bench_tester ) try {
+
+   const uint32_t pool   = 100;
+   const uint32_t probes = env_uint("HORUSPAY_SCALE_PROBES", 20);
+   const auto rate = extended_asset(asset::from_string("10.0000 USD"), N(eosio.token));
+
+   vector<uint32_t> sizes;
+   std::stringstream ss(env_string("HORUSPAY_SCALE_SIZES", "1000,10000,100000"));
+   for( string size; std::getline(ss, size, ','); ) {
+      sizes.push_back( uint32_t(std::stoul(size)) );
+   }
+   std::sort(sizes.begin(), sizes.end());
+
+   create_account_with_resources(N(own1), system_account_name);
+   for( uint32_t i = 0; i < pool; ++i ) {
+      create_account_with_resources(bench_name("usr", i), system_account_name);
+   }
+
+   // Filling 100k rows needs far more RAM than the default contract account has
+   BOOST_REQUIRE_EQUAL( success(), buyram( "eosio", ME, core_sym::from_string("100000.0000") ) );
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("10000000.0000 USD"));
+   issue(name("own1"), asset::from_string("1000000.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(probe), N(own1), rate));
+   transfer_with_memo( name("own1"), ME, asset::from_string("100000.0000 USD"), "probe" );
+
+   std::ofstream out(env_string("HORUSPAY_SCALE_CSV", "horuspay_scaling.csv"));
+   BOOST_REQUIRE(out.good());
+   out << "memberships,action,samples,p50_cpu_us,p95_cpu_us,p50_elapsed_us,p95_elapsed_us" << std::endl;
+
+   uint32_t memberships = 0;
+   for( auto size : sizes ) {
+
+      for( ; memberships < size; ++memberships ) {
+         auto member = bench_name("mbr", memberships);
+         store_row(N(probe), N(projectuser), member.value,
+                   project_user{ member, 0, rate.quantity.get_amount(), 0, block_timestamp_type() });
+      }
+      produce_block();
+
+      samples.clear();
+      for( uint32_t i = 0; i < probes; ++i ) {
+         auto user = bench_name("usr", i % pool);
+
+         BOOST_REQUIRE_EQUAL( success()
+            , adduser(N(probe), N(own1), user));
+         record("adduser");
+
+         BOOST_REQUIRE_EQUAL( success()
+            , addtime(N(probe), user, 3600, {}, {}));
+         record("addtime");
+
+         BOOST_REQUIRE_EQUAL( success()
+            , approve(N(probe), N(own1), user, {}));
+         record("approve");
+
+         BOOST_REQUIRE_EQUAL( success()
+            , removeuser(N(probe), N(own1), user));
+         record("removeuser");
+      }
+
+      for( const auto& entry : samples ) {
+         out << memberships << "," << entry.first << "," << entry.second.cpu_us.size()
+             << "," << percentile(entry.second.cpu_us, 50) << "," << percentile(entry.second.cpu_us, 95)
+             << "," << percentile(entry.second.elapsed_us, 50) << "," << percentile(entry.second.elapsed_us, 95)
+             << std::endl;
+      }
+      BOOST_TEST_MESSAGE( "horuspay scaling: measured at " << memberships << " memberships" );
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// Random but valid mix of create, adduser, deposits, clockin/clockout, addtime, approve,
+// decline, setuserrate and withdraw over many projects. After every step the tokens the
+// contract received must all be accounted for: project balances, user balances and what was
+// withdrawn add up to the deposits, and the contract's token balance to what was not withdrawn.
+
+struct load_project {
+   account_name                           name;
+   account_name                           owner;
+   vector<account_name>                   members;
+   std::map<account_name, fc::time_point> clocked_in;
+};
+
+struct horuspay_load_tester : horuspay_bench_tester {
+
+   const symbol          usd = symbol{4,"USD"};
+   std::mt19937          rng;
+   uint32_t              max_projects = 8;
+   vector<account_name>  owners;
+   vector<account_name>  users;
+   vector<load_project>  projects;
+   asset                 deposited = asset(0, usd);
+   asset                 withdrawn = asset(0, usd);
+   fc::microseconds      pushing;
+   uint32_t              pushed = 0;
+
+   void setup( uint32_t user_count ) {
+      for( uint32_t i = 0; i < 3; ++i ) {
+         owners.push_back( bench_name("own", i) );
+         create_account_with_resources(owners.back(), system_account_name);
+      }
+      for( uint32_t i = 0; i < user_count; ++i ) {
+         users.push_back( bench_name("usr", i) );
+         create_account_with_resources(users.back(), system_account_name);
+      }
+      BOOST_REQUIRE_EQUAL( success(), buyram( "eosio", ME, core_sym::from_string("10000.0000") ) );
+
+      create_currency(name("eosio.token"), system_account_name, asset::from_string("1000000000.0000 USD"));
+      for( auto owner : owners ) {
+         issue(owner, asset::from_string("100000000.0000 USD"));
+      }
+   }
+
+   uint64_t random( uint64_t low, uint64_t high ) {
+      return std::uniform_int_distribution<uint64_t>(low, high)(rng);
+   }
+
+   template<typename T>
+   const T& pick( const vector<T>& values ) {
+      return values[ random(0, values.size() - 1) ];
+   }
+
+   extended_asset random_rate() {
+      return extended_asset( asset(random(1, 50) * 10000, usd), N(eosio.token) );
+   }
+
+   // Pushes through `push`, adding the time it took (block production included) to the
+   // throughput and its costs to the distribution of `action` when it succeeds
+   template<typename Push>
+   action_result timed( const string& action, Push&& push ) {
+      auto start = fc::time_point::now();
+      action_result result = push();
+      pushing += fc::time_point::now() - start;
+      if( result == success() ) {
+         ++pushed;
+         record(action);
+      }
+      return result;
+   }
+
+   vector<project_user> with_pending( const load_project& p ) {
+      vector<project_user> rows;
+      for( const auto& pu : get_project_users(p.name) ) {
+         if( pu.pending > 0 ) rows.push_back(pu);
+      }
+      return rows;
+   }
+
+   // Runs one random action, returns false when the picked action has nothing to act on
+   bool step() {
+      enum op { op_create, op_adduser, op_deposit, op_clockin, op_clockout, op_addtime,
+                op_approve, op_decline, op_setuserrate, op_withdraw };
+      static const vector<double> weights = { 1, 4, 3, 3, 3, 6, 5, 2, 2, 2 };
+      auto next = op( std::discrete_distribution<int>(weights.begin(), weights.end())(rng) );
+
+      if( next == op_create || projects.empty() ) {
+         if( projects.size() >= max_projects ) return false;
+
+         load_project p{ bench_name("prj", projects.size()), pick(owners) };
+         BOOST_REQUIRE_EQUAL( success(), timed("create", [&]{
+            return create(p.name, p.owner, random_rate());
+         }));
+         projects.push_back(p);
+         return true;
+      }
+
+      auto& p = projects[ random(0, projects.size() - 1) ];
+      switch( next ) {
+         case op_adduser: {
+            vector<account_name> candidates;
+            for( auto user : users ) {
+               if( std::find(p.members.begin(), p.members.end(), user) == p.members.end() ) candidates.push_back(user);
+            }
+            if( candidates.empty() ) return false;
+
+            auto user = pick(candidates);
+            BOOST_REQUIRE_EQUAL( success(), timed("adduser", [&]{
+               return adduser(p.name, p.owner, user);
+            }));
+            p.members.push_back(user);
+            return true;
+         }
+         case op_deposit: {
+            auto amount = asset(random(10, 1000) * 10000, usd);
+            timed("on_transfer", [&]{
+               transfer_with_memo( p.owner, ME, amount, p.name.to_string() );
+               produce_block();
+               return success();
+            });
+            deposited += amount;
+            return true;
+         }
+         case op_clockin: {
+            vector<account_name> candidates;
+            for( auto user : p.members ) {
+               if( !p.clocked_in.count(user) ) candidates.push_back(user);
+            }
+            if( candidates.empty() ) return false;
+
+            auto user = pick(candidates);
+            auto time = control->pending_block_time();
+            BOOST_REQUIRE_EQUAL( success(), timed("clockin", [&]{
+               return clockin(p.name, user);
+            }));
+            p.clocked_in[user] = time;
+            return true;
+         }
+         case op_clockout: {
+            if( p.clocked_in.empty() ) return false;
+
+            auto itr = p.clocked_in.begin();
+            std::advance( itr, random(0, p.clocked_in.size() - 1) );
+            if( control->pending_block_time() - itr->second < fc::seconds(1) ) {
+               produce_blocks(2);
+            }
+            BOOST_REQUIRE_EQUAL( success(), timed("clockout", [&]{
+               return clockout(p.name, itr->first, {});
+            }));
+            p.clocked_in.erase(itr);
+            return true;
+         }
+         case op_addtime: {
+            if( p.members.empty() ) return false;
+
+            auto user    = pick(p.members);
+            auto manager = random(0, 1) ? optional<account_name>(p.owner) : optional<account_name>();
+            BOOST_REQUIRE_EQUAL( success(), timed("addtime", [&]{
+               return addtime(p.name, user, random(1, 8 * 3600), {}, manager);
+            }));
+            return true;
+         }
+         case op_approve: {
+            auto candidates = with_pending(p);
+            if( candidates.empty() ) return false;
+
+            const auto& pu = pick(candidates);
+            auto seconds = random(0, 1) ? optional<int64_t>(random(1, uint64_t(pu.pending))) : optional<int64_t>();
+            auto result  = timed("approve", [&]{
+               return approve(p.name, p.owner, pu.user, seconds);
+            });
+            // running out of funds is a valid outcome of random load
+            if( result != success() ) {
+               BOOST_REQUIRE_EQUAL( wasm_assert_msg("not enough funds"), result );
+            }
+            return true;
+         }
+         case op_decline: {
+            auto candidates = with_pending(p);
+            if( candidates.empty() ) return false;
+
+            const auto& pu = pick(candidates);
+            BOOST_REQUIRE_EQUAL( success(), timed("decline", [&]{
+               return decline(p.name, p.owner, pu.user, random(1, uint64_t(pu.pending)));
+            }));
+            return true;
+         }
+         case op_setuserrate: {
+            if( p.members.empty() ) return false;
+
+            auto user = pick(p.members);
+            BOOST_REQUIRE_EQUAL( success(), timed("setuserrate", [&]{
+               return setuserrate(p.name, p.owner, user, random_rate());
+            }));
+            return true;
+         }
+         default: {
+            auto user    = pick(users);
+            auto balance = get_internal_balance(user, usd);
+            if( balance.get_amount() == 0 ) return false;
+
+            auto amount = asset(int64_t(random(1, uint64_t(balance.get_amount()))), usd);
+            BOOST_REQUIRE_EQUAL( success(), timed("withdraw", [&]{
+               return withdraw(user, amount);
+            }));
+            withdrawn += amount;
+            return true;
+         }
+      }
+   }
+
+   void check_conservation() {
+      auto projects_total = asset(0, usd);
+      for( const auto& p : get_scope_rows<project>(ME, N(project), "project") ) {
+         projects_total += p.balance.quantity;
+      }
+      auto accounts_total = asset(0, usd);
+      for( auto user : users ) {
+         accounts_total += get_internal_balance(user, usd);
+      }
+
+      BOOST_REQUIRE_EQUAL( deposited, projects_total + accounts_total + withdrawn );
+      BOOST_REQUIRE_EQUAL( deposited - withdrawn, get_balance(ME, usd) );
+   }
+};
+
+BOOST_AUTO_TEST_SUITE(horuspay_load)
+
+BOOST_FIXTURE_TEST_CASE( conservation_under_random_load, horuspay_load_tester ) try {
+
+   const uint32_t steps = env_uint("HORUSPAY_LOAD_STEPS", 300);
+   rng.seed( env_uint("HORUSPAY_LOAD_SEED", 1) );
+   max_projects = env_uint("HORUSPAY_LOAD_PROJECTS", 8);
+   setup( env_uint("HORUSPAY_LOAD_USERS", 16) );
+
+   for( uint32_t done = 0; done < steps; ) {
+      if( !step() ) continue;
+      ++done;
+      check_conservation();
+   }
+
+   BOOST_TEST_MESSAGE( "horuspay load: " << pushed << " actions in " << pushing.count() / 1000 << " ms, "
+                       << ( pushing.count() ? pushed * 1000000ll / pushing.count() : 0 ) << " actions/s" );
+   for( const auto& entry : samples ) {
+      BOOST_TEST_MESSAGE( "   " << entry.first << ": " << entry.second.cpu_us.size() << " samples, cpu_us p50 "
+                          << percentile(entry.second.cpu_us, 50) << " p95 " << percentile(entry.second.cpu_us, 95)
+                          << " max " << percentile(entry.second.cpu_us, 100) );
+   }
+
+   const auto csv = env_string("HORUSPAY_LOAD_CSV", "");
+   if( !csv.empty() ) {
+      write_csv(csv);
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
+
+// RAM billed to the contract per entity, broken down by table. Runs with the regular tests
+// because the breakdown must add up to the RAM the chain actually charged.
+//
+// HORUSPAY_RAM_CSV           optional output file with one line per action and table
+
+struct table_usage {
+   int64_t rows  = 0;
+   int64_t bytes = 0;
+};
+
+struct horuspay_ram_tester : horuspay_bench_tester {
+
+   template<typename Index, typename Object>
+   int64_t secondary_rows( const table_id& id ) {
+      const auto& idx = control->db().get_index<Index, by_primary>();
+      int64_t rows = 0;
+      for( auto itr = idx.lower_bound( boost::make_tuple(id) ); itr != idx.end() && itr->t_id == id; ++itr ) {
+         ++rows;
+      }
+      return rows * int64_t(config::billable_size_v<Object>);
+   }
+
+   // Billable bytes of every contract table over all scopes; secondary index tables are
+   // folded into the table they belong to
+   std::map<string, table_usage> table_ram() {
+      std::map<string, table_usage> usage;
+      const auto& db     = control->db();
+      const auto& tables = db.get_index<table_id_multi_index, by_code_scope_table>();
+      const auto& rows   = db.get_index<key_value_index, by_scope_primary>();
+
+      for( auto t = tables.lower_bound( boost::make_tuple(ME) ); t != tables.end() && t->code == ME; ++t ) {
+         auto& u = usage[ name(t->table.to_uint64_t() & 0xFFFFFFFFFFFFFFF0ULL).to_string() ];
+         u.bytes += config::billable_size_v<table_id_object>;
+
+         for( auto r = rows.lower_bound( boost::make_tuple(t->id) ); r != rows.end() && r->t_id == t->id; ++r ) {
+            u.rows  += 1;
+            u.bytes += r->value.size() + config::billable_size_v<key_value_object>;
+         }
+         u.bytes += secondary_rows<index64_index, index64_object>(t->id);
+         u.bytes += secondary_rows<index128_index, index128_object>(t->id);
+         u.bytes += secondary_rows<index256_index, index256_object>(t->id);
+         u.bytes += secondary_rows<index_double_index, index_double_object>(t->id);
+         u.bytes += secondary_rows<index_long_double_index, index_long_double_object>(t->id);
+      }
+      return usage;
+   }
+
+   struct ram_sample {
+      string                         entity;
+      string                         action;
+      int64_t                        account_delta;
+      std::map<string, table_usage>  tables;
+   };
+   vector<ram_sample> ram_samples;
+
+   // Runs `push`, which must create rows, and records the RAM it charged to the contract
+   template<typename Push>
+   void measure( const string& entity, const string& action, Push&& push ) {
+      const auto& rlm = control->get_resource_limits_manager();
+      auto before     = table_ram();
+      int64_t ram     = rlm.get_account_ram_usage(ME);
+
+      BOOST_REQUIRE_EQUAL( success(), push() );
+
+      ram_sample sample{ entity, action, rlm.get_account_ram_usage(ME) - ram, {} };
+      int64_t total = 0;
+      for( const auto& t : table_ram() ) {
+         auto delta = table_usage{ t.second.rows - before[t.first].rows, t.second.bytes - before[t.first].bytes };
+         if( delta.bytes == 0 ) continue;
+         sample.tables[t.first] = delta;
+         total += delta.bytes;
+      }
+      BOOST_REQUIRE_EQUAL( total, sample.account_delta );
+      ram_samples.push_back( std::move(sample) );
+   }
+
+   void report() const {
+      const auto csv = env_string("HORUSPAY_RAM_CSV", "");
+      std::ofstream out;
+      if( !csv.empty() ) {
+         out.open(csv);
+         out << "entity,action,table,rows,bytes,account_delta" << std::endl;
+      }
+
+      for( const auto& s : ram_samples ) {
+         std::stringstream line;
+         line << s.entity << " (" << s.action << "): " << s.account_delta << " bytes";
+         for( const auto& t : s.tables ) {
+            line << ", " << t.first << " " << t.second.bytes << " (" << t.second.rows << " rows)";
+            if( out.is_open() ) {
+               out << s.entity << "," << s.action << "," << t.first << "," << t.second.rows
+                   << "," << t.second.bytes << "," << s.account_delta << std::endl;
+            }
+         }
+         BOOST_TEST_MESSAGE( line.str() );
+      }
+   }
+};
+
+BOOST_AUTO_TEST_SUITE(horuspay_ram)
+
+BOOST_FIXTURE_TEST_CASE( ram_per_entity, horuspay_ram_tester ) try {
+
+   const auto rate = extended_asset(asset::from_string("10.0000 USD"), N(eosio.token));
+
+   create_account_with_resources(N(own1), system_account_name);
+   for( uint32_t i = 0; i < 4; ++i ) {
+      create_account_with_resources(bench_name("usr", i), system_account_name);
+      create_account_with_resources(bench_name("mgr", i), system_account_name);
+   }
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+   issue(name("own1"), asset::from_string("1000.0000 USD"));
+
+   for( uint32_t p = 0; p < 2; ++p ) {
+      auto project = bench_name("prj", p);
+
+      measure( p == 0 ? "first project" : "project", "create", [&]{
+         return create(project, N(own1), rate);
+      });
+
+      for( uint32_t i = 0; i < 4; ++i ) {
+         measure( i == 0 ? "first member of project" : "member", "adduser", [&]{
+            return adduser(project, N(own1), bench_name("usr", i));
+         });
+         measure( "manager", "addmanager", [&]{
+            return addmanager(project, N(own1), bench_name("mgr", i));
+         });
+      }
+   }
+
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "prja" );
+   for( uint32_t i = 0; i < 4; ++i ) {
+      BOOST_REQUIRE_EQUAL( success()
+         , addtime(N(prja), bench_name("usr", i), 3600, {}, {}));
+      measure( "user balance", "approve", [&]{
+         return approve(N(prja), N(own1), bench_name("usr", i), {});
+      });
+   }
+
+   report();
+
+   // Steady state costs: one row in the entity table, nothing else
+   for( const auto& s : ram_samples ) {
+      if( s.entity == "member" ) {
+         BOOST_REQUIRE_EQUAL( s.tables.size(), 1 );
+         BOOST_REQUIRE_EQUAL( s.tables.count("projectuser"), 1 );
+      }
+      if( s.entity == "manager" ) {
+         BOOST_REQUIRE_EQUAL( s.tables.size(), 1 );
+         BOOST_REQUIRE_EQUAL( s.tables.count("projectmgr"), 1 );
+      }
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,282 @@
+#include "horuspay_tester.hpp"
+
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fstream>
+#include <sstream>
+
+// Replays the action streams in tests/streams on the chain and through the native driver
+// (native/, horuspay_sim) and requires both to end with identical contract tables.
+//
+// The tools built by tests/CMakeLists.txt are used unless these point to other builds; a case
+// whose tool does not exist is reported as skipped.
+//
+// HORUSPAY_NATIVE_SIM        path to horuspay_sim
+// HORUSPAY_NATIVE_INDEXER    path to horuspay_indexer, which indexes the traces of a replay
+
+#ifndef HORUSPAY_NATIVE_SIM_PATH
+#define HORUSPAY_NATIVE_SIM_PATH ""
+#endif
+#ifndef HORUSPAY_NATIVE_INDEXER_PATH
+#define HORUSPAY_NATIVE_INDEXER_PATH ""
+#endif
+
+static string native_sim() {
+   const char* path = std::getenv("HORUSPAY_NATIVE_SIM");
+   return path ? path : HORUSPAY_NATIVE_SIM_PATH;
+}
+
+static string native_indexer() {
+   const char* path = std::getenv("HORUSPAY_NATIVE_INDEXER");
+   return path ? path : HORUSPAY_NATIVE_INDEXER_PATH;
+}
+
+// Test case precondition: the native tool exists
+struct native_tool_built {
+   string (*path)();
+
+   boost::test_tools::assertion_result operator()( boost::unit_test::test_unit_id )const {
+      auto tool = path();
+      boost::test_tools::assertion_result result( !tool.empty() && fc::exists(fc::path(tool)) );
+      result.message() << "native tool not built: " << (tool.empty() ? string("no path configured") : tool);
+      return result;
+   }
+};
+
+struct horuspay_stream_tester : horuspay_light_tester {
+
+   std::ofstream traces;
+
+   static vector<string> tokenize( string line ) {
+      auto hash = line.find('#');
+      if( hash != string::npos ) line.erase(hash);
+
+      vector<string> tokens;
+      std::stringstream ss(line);
+      for( string t; ss >> t; ) tokens.push_back(t);
+      return tokens;
+   }
+
+   // Appends the last transaction trace to `traces`, as nodeos prints it
+   void record_trace() {
+      if( !traces.is_open() ) return;
+      traces << fc::json::to_string( control->to_variant_with_abi( *last_tx_trace, abi_serializer_max_time ) ) << "\n";
+   }
+
+   // Converts stream tokens to the variant of an ABI field, see native/src/driver.cpp for the format
+   fc::variant stream_arg( const string& type, const vector<string>& tokens, size_t& pos ) {
+      auto next = [&]() -> const string& {
+         BOOST_REQUIRE_MESSAGE( pos < tokens.size(), "missing argument of type " << type );
+         return tokens[pos++];
+      };
+
+      if( type.back() == '?' ) {
+         if( pos < tokens.size() && tokens[pos] == "-" ) {
+            ++pos;
+            return fc::variant();
+         }
+         return stream_arg( type.substr(0, type.size() - 1), tokens, pos );
+      }
+      if( type == "asset" ) {
+         auto amount = next();
+         return fc::variant( amount + " " + next() );
+      }
+      if( type == "extended_asset" ) {
+         auto quantity = stream_arg("asset", tokens, pos);
+         return mvo()("quantity", quantity)("contract", next());
+      }
+      if( type.size() > 2 && type.substr(type.size() - 2) == "[]" ) {
+         auto element = type.substr(0, type.size() - 2);
+         vector<fc::variant> items;
+         if( !horuspay_abi.is_struct(element) ) {
+            while( pos < tokens.size() ) items.emplace_back( next() );
+            return fc::variant(items);
+         }
+
+         const auto& fields = horuspay_abi.get_struct(element).fields;
+         while( pos < tokens.size() ) {
+            vector<string> parts;
+            std::stringstream ss(next());
+            for( string p; std::getline(ss, p, ':'); ) parts.push_back(p);
+
+            mvo item;
+            for( size_t i = 0; i < fields.size(); ++i ) {
+               item( fields[i].name, i < parts.size() && parts[i] != "-" ? fc::variant(parts[i]) : fc::variant() );
+            }
+            items.emplace_back(item);
+         }
+         return fc::variant(items);
+      }
+      // names, integers and strings
+      return fc::variant( next() );
+   }
+
+   // Replays `stream` and returns the time of the block of its first pushed action
+   int64_t replay_stream( const fc::path& stream ) {
+      std::ifstream in( stream.generic_string() );
+      BOOST_REQUIRE_MESSAGE( in.good(), "can't open " << stream.generic_string() );
+
+      std::set<symbol> currencies;
+      optional<int64_t> start;
+      string line;
+      while( std::getline(in, line) ) {
+         auto tokens = tokenize(line);
+         if( tokens.empty() ) continue;
+
+         const auto& cmd = tokens[0];
+         size_t pos = 1;
+         if( cmd == "account" ) {
+            for( ; pos < tokens.size(); ++pos ) {
+               if( !control->db().find<account_object, by_name>( account_name(tokens[pos]) ) ) {
+                  create_account( account_name(tokens[pos]) );
+               }
+            }
+         } else if( cmd == "wait" ) {
+            produce_blocks( std::stoul(tokens[1]) );
+         } else if( cmd == "issue" ) {
+            auto quantity = asset::from_string( tokens[2] + " " + tokens[3] );
+            if( currencies.insert(quantity.get_symbol()).second ) {
+               create_currency( N(eosio.token), system_account_name, asset(std::numeric_limits<int64_t>::max() / 2, quantity.get_symbol()) );
+            }
+            issue( account_name(tokens[1]), quantity );
+         } else if( cmd == "transfer" ) {
+            try {
+               transfer_with_memo( account_name(tokens[1]), ME, asset::from_string(tokens[3] + " " + tokens[4]), tokens[2], account_name(tokens[5]) );
+               record_trace();
+            } catch( const fc::exception& ) {
+               // failed deposits leave no trace, like in the native driver
+            }
+         } else {
+            BOOST_REQUIRE_EQUAL( cmd, "push" );
+            if( !start ) start = control->pending_block_time().time_since_epoch().count();
+
+            auto signer = account_name(tokens[1]);
+            auto action = action_name(tokens[2]);
+            pos = 3;
+
+            mvo data;
+            for( const auto& field : horuspay_abi.get_struct( horuspay_abi.get_action_type(action) ).fields ) {
+               data( field.name, stream_arg(field.type, tokens, pos) );
+            }
+            BOOST_REQUIRE_MESSAGE( pos == tokens.size(), "too many arguments: " << line );
+            if( call( signer, action, data ) == success() ) record_trace();
+         }
+      }
+      return start ? *start : control->pending_block_time().time_since_epoch().count();
+   }
+
+   // One line per contract row: scope table primary_key hex, sorted
+   vector<string> dump_tables() {
+      vector<string> lines;
+      const auto& db     = control->db();
+      const auto& tables = db.get_index<table_id_multi_index, by_code_scope_table>();
+      const auto& rows   = db.get_index<key_value_index, by_scope_primary>();
+
+      for( auto t = tables.lower_bound( boost::make_tuple(ME) ); t != tables.end() && t->code == ME; ++t ) {
+         for( auto r = rows.lower_bound( boost::make_tuple(t->id) ); r != rows.end() && r->t_id == t->id; ++r ) {
+            lines.push_back( name(t->scope).to_string() + " " + t->table.to_string() + " "
+                             + std::to_string(r->primary_key) + " " + fc::to_hex(r->value.data(), r->value.size()) );
+         }
+      }
+      std::sort(lines.begin(), lines.end());
+      return lines;
+   }
+
+   static vector<string> read_lines( const fc::path& file ) {
+      std::ifstream in( file.generic_string() );
+      vector<string> lines;
+      for( string line; std::getline(in, line); ) {
+         if( !line.empty() ) lines.push_back(line);
+      }
+      return lines;
+   }
+
+   void check_stream( const string& stream_name ) {
+      auto sim = native_sim();
+
+      auto stream = fc::path(__FILE__).parent_path() / "streams" / stream_name;
+      auto start  = replay_stream(stream);
+      auto chain  = dump_tables();
+
+      fc::temp_directory dir;
+      auto dump = dir.path() / "native.txt";
+      std::stringstream cmd;
+      cmd << sim << " --start " << start << " --dump " << dump.generic_string() << " " << stream.generic_string();
+      BOOST_REQUIRE_EQUAL( 0, std::system(cmd.str().c_str()) );
+
+      auto native = read_lines(dump);
+      BOOST_REQUIRE( !chain.empty() );
+      BOOST_REQUIRE_EQUAL( chain.size(), native.size() );
+      for( size_t i = 0; i < chain.size(); ++i ) {
+         BOOST_REQUIRE_EQUAL( chain[i], native[i] );
+      }
+   }
+};
+
+BOOST_AUTO_TEST_SUITE(horuspay_differential)
+
+BOOST_FIXTURE_TEST_CASE( payroll_stream, horuspay_stream_tester,
+                         * boost::unit_test::precondition(native_tool_built{ native_sim }) ) try {
+   check_stream("payroll.txt");
+} FC_LOG_AND_RETHROW()
+
+// The indexer totals of the logevent traces of a replay must add up to the contract tables
+BOOST_FIXTURE_TEST_CASE( indexer_stream, horuspay_stream_tester,
+                         * boost::unit_test::precondition(native_tool_built{ native_indexer }) ) try {
+   auto indexer = native_indexer();
+
+   fc::temp_directory dir;
+   auto dump  = dir.path() / "traces.jsonl";
+   auto index = dir.path() / "horuspay.idx";
+
+   BOOST_REQUIRE_EQUAL( success(), setsink(ME) );
+   traces.open( dump.generic_string() );
+   replay_stream( fc::path(__FILE__).parent_path() / "streams" / "payroll.txt" );
+   traces.close();
+
+   auto run = [&]( const string& args ) {
+      auto out = dir.path() / "out.txt";
+      std::stringstream cmd;
+      cmd << indexer << " --index " << index.generic_string() << " " << args << " > " << out.generic_string();
+      BOOST_REQUIRE_EQUAL( 0, std::system(cmd.str().c_str()) );
+      return read_lines(out);
+   };
+
+   // logged, approved, declined, paid, deposited, withdrawn and events of the total line
+   auto totals = [&]( const string& query ) {
+      auto lines = run( "--seconds query " + query );
+      std::stringstream ss( lines.back() );
+      string week, start, user;
+      ss >> week >> start >> user;
+      BOOST_REQUIRE_EQUAL( week, "total" );
+      vector<int64_t> columns;
+      for( int64_t v; ss >> v; ) columns.push_back(v);
+      BOOST_REQUIRE_EQUAL( columns.size(), 7 );
+      return columns;
+   };
+
+   run( "ingest " + dump.generic_string() );
+   // indexed records are skipped when the same dump is ingested again
+   run( "ingest " + dump.generic_string() );
+
+   // another file is refused instead of being resumed at the offset of the first one
+   auto copy = dir.path() / "copy.jsonl";
+   fc::copy( dump, copy );
+   std::stringstream refused;
+   refused << indexer << " --index " << index.generic_string() << " ingest " << copy.generic_string() << " 2> /dev/null";
+   BOOST_REQUIRE( std::system(refused.str().c_str()) != 0 );
+   run( "--rebuild ingest " + copy.generic_string() );
+
+   for( auto project : { N(proj1), N(proj2) } ) {
+      for( const auto& pu : get_project_users(project) ) {
+         auto t = totals( project.to_string() + " " + pu.user.to_string() );
+         BOOST_REQUIRE_EQUAL( t[0] - t[1] - t[2], pu.pending );
+      }
+      auto t = totals( project.to_string() );
+      BOOST_REQUIRE_EQUAL( t[4] - t[3], get_project(project)->balance.quantity.get_amount() );
+   }
+   BOOST_REQUIRE( totals("proj1")[3] > 0 );
+   BOOST_REQUIRE_EQUAL( totals(". user1")[5], 10000 );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
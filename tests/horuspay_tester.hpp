@@ -0,0 +1,1056 @@
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+#include <eosio/chain/permission_object.hpp>
+#include <eosio/chain/trace.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/snapshot.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <array>
+#include <utility>
+#include <fc/log/logger.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/crypto/hex.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/crypto/signature.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <Runtime/Runtime.h>
+
+#include "eosio.system_tester.hpp"
+
+using namespace eosio_system;
+using namespace eosio;
+using namespace std;
+using namespace fc::crypto;
+
+using eosio::chain::action_trace;
+
+const static account_name ME = account_name("horuspay");
+const static symbol core_symbol = symbol{CORE_SYM};
+const static name system_account_name = eosio::chain::config::system_account_name;
+
+struct eosio_assert_message_is_log {
+   eosio_assert_message_is_log( const string& msg )
+         : expected( "assertion failure with message: " ) {
+      expected.append( msg );
+      std::cout << "eosio_assert_message_is_log (contructor): " << msg << std::endl;
+   }
+
+   bool operator()( const eosio_assert_message_exception& ex ) {
+      std::cout << "operator(): [" << ex.to_string() << "]|[" << expected << "]" << std::endl;
+      return ex.to_string() == expected;
+   }
+
+   string expected;
+};
+
+
+struct project {
+   name           name;
+   extended_asset hourly_rate;
+   extended_asset balance;
+};
+FC_REFLECT( project, (name)(hourly_rate)(balance));
+
+struct project_user {
+   name                 user;
+   int64_t              pending;
+   int64_t              rate;
+   int16_t              carry;
+   block_timestamp_type last_clock;
+};
+FC_REFLECT( project_user, (user)(pending)(rate)(carry)(last_clock));
+
+// projectuser row layout before per-project scopes and rate compaction (also had a 128-bit byusr index)
+struct legacy_project_user {
+   uint64_t             id;
+   name                 project;
+   name                 user;
+   int64_t              pending;
+   extended_asset       hourly_rate;
+   block_timestamp_type last_clock;
+};
+FC_REFLECT( legacy_project_user, (id)(project)(user)(pending)(hourly_rate)(last_clock));
+
+// projectmgr row layout before per-project scopes (also had a 128-bit bymgr index)
+struct legacy_project_manager {
+   uint64_t     id;
+   name         project;
+   name         manager;
+   bool         is_owner;
+};
+FC_REFLECT( legacy_project_manager, (id)(project)(manager)(is_owner));
+
+struct project_manager {
+   name     manager;
+   bool     is_owner;
+};
+FC_REFLECT( project_manager, (manager)(is_owner));
+
+struct project_stats {
+   name     project;
+   int64_t  pending;
+   uint32_t members;
+   uint32_t managers;
+   uint32_t clocked_in;
+   asset    liability;
+};
+FC_REFLECT( project_stats, (project)(pending)(members)(managers)(clocked_in)(liability));
+
+
+// accounts row of the internal ledger
+struct internal_account {
+   asset    balance;
+   name     contract;
+};
+FC_REFLECT( internal_account, (balance)(contract));
+
+struct user_key {
+   name             user;
+   public_key_type  key;
+   uint64_t         nonce;
+};
+FC_REFLECT( user_key, (user)(key)(nonce));
+
+struct period_commit {
+   uint32_t          period;
+   checksum256_type  root;
+   uint32_t          entries;
+   int64_t           seconds;
+   name              manager;
+   uint32_t          disputes;
+   vector<uint32_t>  disputed;
+};
+FC_REFLECT( period_commit, (period)(root)(entries)(seconds)(manager)(disputes)(disputed));
+
+struct ledger_entry {
+   uint64_t              id;
+   name                  user;
+   uint64_t              seconds;
+   block_timestamp_type  start;
+   uint8_t               status;
+};
+FC_REFLECT( ledger_entry, (id)(user)(seconds)(start)(status));
+
+struct entry_rollup {
+   uint64_t   id;
+   name       user;
+   uint32_t   period;
+   uint64_t   approved;
+   uint64_t   declined;
+   uint32_t   entries;
+};
+FC_REFLECT( entry_rollup, (id)(user)(period)(approved)(declined)(entries));
+
+// Typed action data, packed with fc::raw in the same layout as the contract ABI
+namespace horuspay_actions {
+
+struct time_entry {
+   account_name     user;
+   uint64_t         seconds;
+   optional<string> description;
+};
+
+struct approval {
+   account_name      user;
+   optional<int64_t> seconds;
+};
+
+struct timesheet {
+   account_name   project;
+   account_name   user;
+   uint64_t       seconds;
+   uint32_t       period;
+   uint64_t       nonce;
+};
+
+struct signed_timesheet {
+   timesheet      sheet;
+   signature_type sig;
+};
+
+struct period_entry {
+   account_name   user;
+   uint64_t       seconds;
+   string         description;
+};
+
+struct period_total {
+   account_name   user;
+   uint64_t       seconds;
+};
+
+struct create {
+   static account_name get_name() { return N(create); }
+
+   account_name   project;
+   account_name   owner;
+   extended_asset hourly_rate;
+};
+
+struct addtoken {
+   static account_name get_name() { return N(addtoken); }
+
+   account_name contract;
+};
+
+struct rmvtoken {
+   static account_name get_name() { return N(rmvtoken); }
+
+   account_name contract;
+};
+
+struct adduser {
+   static account_name get_name() { return N(adduser); }
+
+   account_name project;
+   account_name manager;
+   account_name user;
+};
+
+struct removeuser {
+   static account_name get_name() { return N(removeuser); }
+
+   account_name project;
+   account_name manager;
+   account_name user;
+};
+
+struct addmanager {
+   static account_name get_name() { return N(addmanager); }
+
+   account_name project;
+   account_name owner;
+   account_name manager;
+};
+
+struct rmvmanager {
+   static account_name get_name() { return N(rmvmanager); }
+
+   account_name project;
+   account_name owner;
+   account_name manager;
+};
+
+struct clockin {
+   static account_name get_name() { return N(clockin); }
+
+   account_name project;
+   account_name user;
+};
+
+struct clockout {
+   static account_name get_name() { return N(clockout); }
+
+   account_name     project;
+   account_name     user;
+   optional<string> description;
+};
+
+struct switchclock {
+   static account_name get_name() { return N(switchclock); }
+
+   account_name     from;
+   account_name     to;
+   account_name     user;
+   optional<string> description;
+};
+
+struct addtime {
+   static account_name get_name() { return N(addtime); }
+
+   account_name           project;
+   account_name           user;
+   uint64_t               seconds;
+   optional<string>       description;
+   optional<account_name> manager;
+};
+
+struct addtimes {
+   static account_name get_name() { return N(addtimes); }
+
+   account_name       project;
+   account_name       manager;
+   vector<time_entry> entries;
+};
+
+struct setkey {
+   static account_name get_name() { return N(setkey); }
+
+   account_name    user;
+   public_key_type key;
+};
+
+struct addsigned {
+   static account_name get_name() { return N(addsigned); }
+
+   account_name             project;
+   account_name             manager;
+   vector<signed_timesheet> sheets;
+};
+
+struct commitperiod {
+   static account_name get_name() { return N(commitperiod); }
+
+   account_name             project;
+   account_name             manager;
+   uint32_t                 period;
+   checksum256_type         root;
+   uint32_t                 entries;
+   vector<period_total>     totals;
+};
+
+struct dispute {
+   static account_name get_name() { return N(dispute); }
+
+   account_name             project;
+   uint32_t                 period;
+   account_name             disputer;
+   period_entry             entry;
+   uint32_t                 index;
+   vector<checksum256_type> proof;
+};
+
+struct approveentry {
+   static account_name get_name() { return N(approveentry); }
+
+   account_name     project;
+   account_name     manager;
+   vector<uint64_t> ids;
+};
+
+struct declineentry {
+   static account_name get_name() { return N(declineentry); }
+
+   account_name     project;
+   account_name     manager;
+   vector<uint64_t> ids;
+};
+
+struct compact {
+   static account_name get_name() { return N(compact); }
+
+   account_name     project;
+   account_name     manager;
+   uint32_t         days;
+   uint32_t         max_rows;
+};
+
+struct setsink {
+   static account_name get_name() { return N(setsink); }
+
+   account_name     sink;
+};
+
+struct migrate {
+   static account_name get_name() { return N(migrate); }
+
+   uint32_t         max_rows;
+};
+
+struct logevent {
+   static account_name get_name() { return N(logevent); }
+
+   account_name     event;
+   account_name     project;
+   account_name     user;
+   int64_t          seconds;
+   int64_t          amount;
+   int64_t          pending;
+};
+
+struct approve {
+   static account_name get_name() { return N(approve); }
+
+   account_name      project;
+   account_name      manager;
+   account_name      user;
+   optional<int64_t> seconds;
+};
+
+struct batchapprove {
+   static account_name get_name() { return N(batchapprove); }
+
+   account_name     project;
+   account_name     manager;
+   vector<approval> approvals;
+};
+
+struct runpayroll {
+   static account_name get_name() { return N(runpayroll); }
+
+   account_name project;
+   account_name manager;
+   uint32_t     max_rows;
+};
+
+struct withdraw {
+   static account_name get_name() { return N(withdraw); }
+
+   account_name user;
+   asset        quantity;
+};
+
+struct decline {
+   static account_name get_name() { return N(decline); }
+
+   account_name project;
+   account_name manager;
+   account_name user;
+   int64_t      seconds;
+};
+
+struct setuserrate {
+   static account_name get_name() { return N(setuserrate); }
+
+   account_name   project;
+   account_name   manager;
+   account_name   user;
+   extended_asset hourly_rate;
+};
+
+}
+
+FC_REFLECT( horuspay_actions::time_entry, (user)(seconds)(description));
+FC_REFLECT( horuspay_actions::approval, (user)(seconds));
+FC_REFLECT( horuspay_actions::timesheet, (project)(user)(seconds)(period)(nonce));
+FC_REFLECT( horuspay_actions::signed_timesheet, (sheet)(sig));
+FC_REFLECT( horuspay_actions::period_entry, (user)(seconds)(description));
+FC_REFLECT( horuspay_actions::period_total, (user)(seconds));
+FC_REFLECT( horuspay_actions::create, (project)(owner)(hourly_rate));
+FC_REFLECT( horuspay_actions::addtoken, (contract));
+FC_REFLECT( horuspay_actions::rmvtoken, (contract));
+FC_REFLECT( horuspay_actions::adduser, (project)(manager)(user));
+FC_REFLECT( horuspay_actions::removeuser, (project)(manager)(user));
+FC_REFLECT( horuspay_actions::addmanager, (project)(owner)(manager));
+FC_REFLECT( horuspay_actions::rmvmanager, (project)(owner)(manager));
+FC_REFLECT( horuspay_actions::clockin, (project)(user));
+FC_REFLECT( horuspay_actions::clockout, (project)(user)(description));
+FC_REFLECT( horuspay_actions::switchclock, (from)(to)(user)(description));
+FC_REFLECT( horuspay_actions::addtime, (project)(user)(seconds)(description)(manager));
+FC_REFLECT( horuspay_actions::addtimes, (project)(manager)(entries));
+FC_REFLECT( horuspay_actions::setkey, (user)(key));
+FC_REFLECT( horuspay_actions::addsigned, (project)(manager)(sheets));
+FC_REFLECT( horuspay_actions::commitperiod, (project)(manager)(period)(root)(entries)(totals));
+FC_REFLECT( horuspay_actions::dispute, (project)(period)(disputer)(entry)(index)(proof));
+FC_REFLECT( horuspay_actions::approveentry, (project)(manager)(ids));
+FC_REFLECT( horuspay_actions::declineentry, (project)(manager)(ids));
+FC_REFLECT( horuspay_actions::compact, (project)(manager)(days)(max_rows));
+FC_REFLECT( horuspay_actions::setsink, (sink));
+FC_REFLECT( horuspay_actions::migrate, (max_rows));
+FC_REFLECT( horuspay_actions::logevent, (event)(project)(user)(seconds)(amount)(pending));
+FC_REFLECT( horuspay_actions::approve, (project)(manager)(user)(seconds));
+FC_REFLECT( horuspay_actions::batchapprove, (project)(manager)(approvals));
+FC_REFLECT( horuspay_actions::runpayroll, (project)(manager)(max_rows));
+FC_REFLECT( horuspay_actions::withdraw, (user)(quantity));
+FC_REFLECT( horuspay_actions::decline, (project)(manager)(user)(seconds));
+FC_REFLECT( horuspay_actions::setuserrate, (project)(manager)(user)(hourly_rate));
+
+
+struct horuspay_tester : eosio_system_tester {
+   
+   abi_serializer horuspay_abi; 
+
+   bool print_console = false;
+   void set_print_console(bool value) {
+      print_console = value;
+   }
+
+   void print_debug(const action_trace& ar) {
+      if (!ar.console.empty()) {
+         cout << ": CONSOLE OUTPUT BEGIN =====================" << endl
+            << ar.console << endl
+            << ": CONSOLE OUTPUT END   =====================" << endl;
+      }
+      // for(const auto& it : ar.inline_traces) {
+      //    print_debug(it);
+      // }
+   }
+
+   horuspay_tester() {
+
+      deploy_horuspay( ME, contracts::horuspay_wasm(), contracts::horuspay_abi() );
+      load_abi( ME, horuspay_abi );
+   }
+
+   // Bare chain without system contracts or horuspay, to be filled by restore_snapshot()
+   explicit horuspay_tester( setup_level level ) : eosio_system_tester(level) {}
+
+   void load_abi( const account_name& account, abi_serializer& serializer ) {
+      const auto& accnt = control->db().get<account_object,by_name>(account);
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      serializer.set_abi(abi, abi_serializer_max_time);
+   }
+
+   // Chain state of this fixture (head block with no pending one) as a variant snapshot
+   fc::variant write_snapshot() {
+      produce_block();
+      control->abort_block();
+
+      fc::mutable_variant_object snapshot;
+      auto writer = std::make_shared<variant_snapshot_writer>(snapshot);
+      control->write_snapshot(writer);
+      writer->finalize();
+      return fc::variant(snapshot);
+   }
+
+   // Replaces the chain of this fixture and of its validating node with `snapshot`
+   void restore_snapshot( const fc::variant& snapshot ) {
+      close();
+      validating_node.reset();
+
+      static uint32_t ordinal = 0;
+      auto dir = tempdir.path() / ("snapshot_" + std::to_string(++ordinal));
+      cfg.blocks_dir  = dir / config::default_blocks_dir_name;
+      cfg.state_dir   = dir / config::default_state_dir_name;
+      vcfg.blocks_dir = dir / ("v_" + string(config::default_blocks_dir_name));
+      vcfg.state_dir  = dir / ("v_" + string(config::default_state_dir_name));
+
+      validating_node = std::make_unique<controller>(vcfg, make_protocol_feature_set());
+      validating_node->add_indices();
+      validating_node->startup( []() { return false; }, std::make_shared<variant_snapshot_reader>(snapshot) );
+
+      last_produced_block.clear();
+      open( std::make_shared<variant_snapshot_reader>(snapshot) );
+
+      load_abi( config::system_account_name, abi_ser );
+      load_abi( N(eosio.token), token_abi_ser );
+      load_abi( ME, horuspay_abi );
+   }
+   
+   // Creates `account` with eosio.code on its active permission and deploys a horuspay build to it
+   void deploy_horuspay( const account_name& account, const vector<uint8_t>& wasm, const vector<char>& abi ) {
+
+      create_account_with_resources(account, system_account_name, 1500000);
+      transfer(system_account_name, account, core_sym::from_string("100.0000"));
+
+      // // const auto& db  = control->db();
+      // // auto me_active = db.get<permission_object, eosio::chain::by_owner>( boost::make_tuple(ME, name("active")) );
+
+      auto trace_auth = TESTER::push_action(system_account_name, updateauth::get_name(), account, mvo()
+                                            ("account", account)
+                                            ("permission", name("active"))
+                                            ("parent", name("owner"))
+                                            ("auth",authority(1,{ key_weight{get_public_key( account, "active" ), 1}}, {permission_level_weight{{account, name("eosio.code")}, 1}})
+                                            )
+      );
+      // BOOST_REQUIRE_EQUAL(transaction_receipt::executed, trace_auth->receipt->status);
+      produce_block();
+
+      set_code( account, wasm );
+      set_abi( account, abi.data() );
+   }
+
+   transaction_trace_ptr last_tx_trace;
+   typename base_tester::action_result my_push_action(action&& act, uint64_t authorizer) {
+      signed_transaction trx;
+      if (authorizer) {
+         act.authorization = vector<permission_level>{{authorizer, name("active")}};
+      }
+      if (batching) {
+         batch.emplace_back(std::move(act));
+         return success();
+      }
+      trx.actions.emplace_back(std::move(act));
+      set_transaction_headers(trx);
+      if (authorizer) {
+         trx.sign(get_private_key(authorizer, "active"), control->get_chain_id());
+      }
+      try {
+         last_tx_trace = push_transaction(trx);
+         if(print_console) {
+            print_debug(last_tx_trace->action_traces[0]);
+         }
+      } catch (const fc::exception& ex) {
+         if(print_console) {
+            cout << "-----EXCEPTION------" << endl
+                 << fc::json::to_string(ex) << endl;
+         }
+         edump((ex));
+         edump((ex.to_detail_string()));
+         return error(ex.top_message()); // top_message() is assumed by many tests; otherwise they fail
+      }
+      produce_block();
+      BOOST_REQUIRE_EQUAL(true, chain_has_transaction(trx.id()));
+      return success();
+   }
+
+   // Batching mode: between begin_batch() and flush() every call() is queued and returns
+   // success(); flush() pushes the queue in transactions of up to max_batch_actions actions,
+   // produces a single block and returns the result of every queued call in order
+   bool           batching = false;
+   size_t         max_batch_actions = 100;
+   vector<action> batch;
+   uint32_t       batch_nonce = 0;
+
+   void begin_batch() {
+      batching = true;
+   }
+
+   vector<action_result> flush() {
+      batching = false;
+
+      vector<action_result> results;
+      for( size_t first = 0; first < batch.size(); first += max_batch_actions ) {
+         vector<action> chunk( batch.begin() + first, batch.begin() + std::min(batch.size(), first + max_batch_actions) );
+
+         if( push_batch(chunk) == success() ) {
+            results.insert( results.end(), chunk.size(), success() );
+            continue;
+         }
+
+         // The chunk was rolled back, push its actions one by one to report each failure
+         for( auto& act : chunk ) {
+            results.push_back( push_batch({ act }) );
+         }
+      }
+      batch.clear();
+      produce_block();
+      return results;
+   }
+
+   action_result push_batch( const vector<action>& actions ) {
+      signed_transaction trx;
+      trx.actions = actions;
+
+      // Different expirations keep equal transactions pushed in the same block apart
+      set_transaction_headers( trx, DEFAULT_EXPIRATION_DELTA + (batch_nonce++ % 3000) );
+
+      std::set<account_name> signers;
+      for( const auto& act : actions ) {
+         for( const auto& auth : act.authorization ) {
+            signers.insert(auth.actor);
+         }
+      }
+      for( const auto& signer : signers ) {
+         trx.sign( get_private_key(signer, "active"), control->get_chain_id() );
+      }
+
+      try {
+         last_tx_trace = push_transaction(trx);
+      } catch (const fc::exception& ex) {
+         return error(ex.top_message());
+      }
+      return success();
+   }
+
+   action_result call( const account_name& signer, const action_name &name, const variant_object &data ) {
+         
+      string action_type_name = horuspay_abi.get_action_type(name);
+
+      action act;
+      act.account = ME;
+      act.name    = name;
+      act.data    = horuspay_abi.variant_to_binary( action_type_name, data, abi_serializer_max_time );
+      return my_push_action(std::move(act), signer);
+   }
+
+   // Typed path: packs the action struct directly, or goes through the ABI when use_abi is set
+   bool use_abi = false;
+
+   template<typename Action>
+   action_result call( const account_name& signer, const Action& data ) {
+      if( use_abi ) {
+         return call( signer, Action::get_name(), fc::variant(data).get_object() );
+      }
+
+      action act;
+      act.account = ME;
+      act.name    = Action::get_name();
+      act.data    = fc::raw::pack(data);
+      return my_push_action(std::move(act), signer);
+   }
+
+   template<typename T>
+   T unpack_row( const vector<char>& data, const string& type ) {
+      if( use_abi ) {
+         return horuspay_abi.binary_to_variant(type, data, abi_serializer_max_time).as<T>();
+      }
+      return fc::raw::unpack<T>(data);
+   }
+
+   action_result create(account_name project, account_name owner, extended_asset hourly_rate) {
+      return call(ME, horuspay_actions::create{ project, owner, hourly_rate });
+   }
+
+   action_result addtoken(account_name contract) {
+      return call(ME, horuspay_actions::addtoken{ contract });
+   }
+
+   action_result rmvtoken(account_name contract) {
+      return call(ME, horuspay_actions::rmvtoken{ contract });
+   }
+
+   action_result adduser(account_name project, account_name manager, account_name user) {
+      return call(manager, horuspay_actions::adduser{ project, manager, user });
+   }
+
+   action_result removeuser(account_name project, account_name manager, account_name user) {
+      return call(manager, horuspay_actions::removeuser{ project, manager, user });
+   }
+
+   action_result addmanager(account_name project, account_name owner, account_name manager) {
+      return call(owner, horuspay_actions::addmanager{ project, owner, manager });
+   }
+
+   action_result rmvmanager(account_name project, account_name owner, account_name manager) {
+      return call(owner, horuspay_actions::rmvmanager{ project, owner, manager });
+   }
+
+   action_result clockin(account_name project, account_name user) {
+      return call(user, horuspay_actions::clockin{ project, user });
+   }
+
+   action_result clockout(account_name project, account_name user, optional<string> description) {
+      return call(user, horuspay_actions::clockout{ project, user, description });
+   }
+
+   action_result switchclock(account_name from, account_name to, account_name user, optional<string> description) {
+      return call(user, horuspay_actions::switchclock{ from, to, user, description });
+   }
+
+   action_result addtime(account_name project, account_name user, uint64_t seconds, optional<string> description, optional<account_name> manager) {
+      return call(user, horuspay_actions::addtime{ project, user, seconds, description, manager });
+   }
+
+   action_result addtimes(account_name project, account_name manager, const vector<std::tuple<account_name, uint64_t, optional<string>>>& entries) {
+      vector<horuspay_actions::time_entry> items;
+      for(const auto& e : entries) {
+         items.push_back({ std::get<0>(e), std::get<1>(e), std::get<2>(e) });
+      }
+      return call(manager, horuspay_actions::addtimes{ project, manager, items });
+   }
+
+   action_result setkey(account_name user, public_key_type key) {
+      return call(user, horuspay_actions::setkey{ user, key });
+   }
+
+   // Signs like a user wallet would: sha256 of the packed contract account and timesheet
+   horuspay_actions::signed_timesheet sign_timesheet(const horuspay_actions::timesheet& sheet, account_name signer = account_name()) {
+      auto packed = fc::raw::pack(ME);
+      auto data   = fc::raw::pack(sheet);
+      packed.insert(packed.end(), data.begin(), data.end());
+
+      auto digest = fc::sha256::hash(packed.data(), packed.size());
+      return { sheet, get_private_key(signer == account_name() ? sheet.user : signer, "active").sign(digest) };
+   }
+
+   action_result addsigned(account_name project, account_name manager, const vector<horuspay_actions::signed_timesheet>& sheets) {
+      return call(manager, horuspay_actions::addsigned{ project, manager, sheets });
+   }
+
+   action_result commitperiod(account_name project, account_name manager, uint32_t period, const checksum256_type& root, uint32_t entries,
+                              const vector<horuspay_actions::period_total>& totals) {
+      return call(manager, horuspay_actions::commitperiod{ project, manager, period, root, entries, totals });
+   }
+
+   action_result dispute(account_name project, uint32_t period, account_name disputer, const horuspay_actions::period_entry& entry,
+                         uint32_t index, const vector<checksum256_type>& proof) {
+      return call(disputer, horuspay_actions::dispute{ project, period, disputer, entry, index, proof });
+   }
+
+   // Period trees as built by the contract: leaves are sha256(0x00 + packed entry), nodes
+   // sha256(0x01 + left + right) and the last node of an odd level moves up unchanged
+   static vector<vector<checksum256_type>> merkle_levels(const vector<horuspay_actions::period_entry>& entries) {
+      vector<vector<checksum256_type>> levels(1);
+      for(const auto& e : entries) {
+         auto packed = fc::raw::pack(e);
+         packed.insert(packed.begin(), char(0));
+         levels[0].push_back( fc::sha256::hash(packed.data(), packed.size()) );
+      }
+      while(levels.back().size() > 1) {
+         const auto& level = levels.back();
+         vector<checksum256_type> next;
+         for(size_t i = 0; i < level.size(); i += 2) {
+            if(i + 1 == level.size()) {
+               next.push_back(level[i]);
+               continue;
+            }
+            char buffer[65];
+            buffer[0] = 1;
+            memcpy(buffer + 1, level[i].data(), 32);
+            memcpy(buffer + 33, level[i + 1].data(), 32);
+            next.push_back( fc::sha256::hash(buffer, sizeof(buffer)) );
+         }
+         levels.push_back(std::move(next));
+      }
+      return levels;
+   }
+
+   static vector<checksum256_type> merkle_proof(const vector<vector<checksum256_type>>& levels, uint32_t index) {
+      vector<checksum256_type> proof;
+      for(size_t l = 0; l + 1 < levels.size(); ++l, index /= 2) {
+         uint32_t sibling = index ^ 1;
+         if(sibling < levels[l].size()) proof.push_back(levels[l][sibling]);
+      }
+      return proof;
+   }
+
+   action_result approveentry(account_name project, account_name manager, const vector<uint64_t>& ids) {
+      return call(manager, horuspay_actions::approveentry{ project, manager, ids });
+   }
+
+   action_result declineentry(account_name project, account_name manager, const vector<uint64_t>& ids) {
+      return call(manager, horuspay_actions::declineentry{ project, manager, ids });
+   }
+
+   action_result compact(account_name project, account_name manager, uint32_t days, uint32_t max_rows) {
+      return call(manager, horuspay_actions::compact{ project, manager, days, max_rows });
+   }
+
+   action_result setsink(account_name sink) {
+      return call(ME, horuspay_actions::setsink{ sink });
+   }
+
+   action_result migrate(uint32_t max_rows) {
+      return call(ME, horuspay_actions::migrate{ max_rows });
+   }
+
+   // logevent actions of the last transaction, and the accounts each one was delivered to
+   vector<std::pair<horuspay_actions::logevent, vector<account_name>>> last_events() {
+      vector<std::pair<horuspay_actions::logevent, vector<account_name>>> events;
+      BOOST_REQUIRE(last_tx_trace);
+      for( const auto& at : last_tx_trace->action_traces ) {
+         if( at.act.account != ME || at.act.name != N(logevent) )
+            continue;
+         if( at.receiver == ME ) {
+            events.emplace_back( fc::raw::unpack<horuspay_actions::logevent>(at.act.data), vector<account_name>() );
+         }
+         events.back().second.push_back(at.receiver);
+      }
+      return events;
+   }
+
+   action_result approve(account_name project, account_name manager, account_name user, optional<int64_t> seconds) {
+      return call(manager, horuspay_actions::approve{ project, manager, user, seconds });
+   }
+
+   action_result batchapprove(account_name project, account_name manager, const vector<std::pair<account_name, optional<int64_t>>>& approvals) {
+      vector<horuspay_actions::approval> items;
+      for(const auto& a : approvals) {
+         items.push_back({ a.first, a.second });
+      }
+      return call(manager, horuspay_actions::batchapprove{ project, manager, items });
+   }
+
+   action_result runpayroll(account_name project, account_name manager, uint32_t max_rows) {
+      return call(manager, horuspay_actions::runpayroll{ project, manager, max_rows });
+   }
+
+   action_result withdraw(account_name user, asset quantity) {
+      return call(user, horuspay_actions::withdraw{ user, quantity });
+   }
+
+   action_result decline(account_name project, account_name manager, account_name user, int64_t seconds) {
+      return call(manager, horuspay_actions::decline{ project, manager, user, seconds });
+   }
+
+   action_result setuserrate(account_name project, account_name manager, account_name user, extended_asset hourly_rate) {
+      return call(manager, horuspay_actions::setuserrate{ project, manager, user, hourly_rate });
+   }
+
+   action_result setprjrate(account_name project, account_name manager, account_name user, extended_asset hourly_rate) {
+      return call(manager, horuspay_actions::setuserrate{ project, manager, user, hourly_rate });
+   }
+
+   void transfer_with_memo( name from, name to, const asset& amount, const string& memo = "", name token_contract=N(eosio.token) ) {
+      last_tx_trace = base_tester::push_action( token_contract, N(transfer), from, mutable_variant_object()
+                                ("from",     from)
+                                ("to",       to )
+                                ("quantity", amount)
+                                ("memo",     memo)
+                                );
+      print_debug(last_tx_trace->action_traces[0]);
+   }
+
+   optional<project> get_project(const account_name& prjname) {
+      vector<char> data = get_row_by_account( ME, ME, N(project), prjname );
+      if( data.empty() )
+         return {};
+      std::cout << "get_row_by_account: " << fc::to_hex(data) << std::endl;
+      return unpack_row<project>(data, "project");
+   }
+
+   optional<project_manager> get_project_manager(const account_name& prjname, const account_name& manager) {
+      vector<char> data = get_row_by_account( ME, prjname, N(projectmgr), manager );
+      if( data.empty() )
+         return {};
+
+      std::cout << "get_project_manager: " << fc::to_hex(data) << std::endl;
+      return unpack_row<project_manager>(data, "project_manager");
+   }
+
+   optional<project_user> get_project_user(const account_name& prjname, const account_name& user) {
+      vector<char> data = get_row_by_account( ME, prjname, N(projectuser), user );
+      if( data.empty() )
+         return {};
+
+      std::cout << "get_project_user: " << fc::to_hex(data) << std::endl;
+      return unpack_row<project_user>(data, "project_user");
+   }
+
+   // Rows of one table scope with lower <= primary key < upper, in primary key order
+   template<typename T>
+   vector<T> get_scope_rows(const account_name& scope, const account_name& table, const string& type,
+                            uint64_t lower = 0, uint64_t upper = std::numeric_limits<uint64_t>::max()) {
+      vector<T> rows;
+      const auto& db = control->db();
+      const auto* t_id = db.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( ME, scope, table ) );
+      if( !t_id )
+         return rows;
+
+      const auto& idx = db.get_index<chain::key_value_index, chain::by_scope_primary>();
+      auto itr = idx.lower_bound( boost::make_tuple( t_id->id, lower ) );
+      auto end = idx.lower_bound( boost::make_tuple( t_id->id, upper ) );
+      for( ; itr != end; ++itr ) {
+         vector<char> data( itr->value.data(), itr->value.data() + itr->value.size() );
+         rows.push_back( unpack_row<T>(data, type) );
+      }
+      return rows;
+   }
+
+   // writes a contract row directly to the chain database, billed to the contract, to reproduce
+   // state written by older versions of the contract (secondary index rows are not written)
+   template<typename T>
+   void store_row(const account_name& scope, const account_name& table, uint64_t primary, const T& row) {
+      auto& db   = control->mutable_db();
+      auto  data = fc::raw::pack(row);
+      int64_t ram = data.size() + config::billable_size_v<chain::key_value_object>;
+
+      const auto* t_id = db.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( ME, scope, table ) );
+      if( !t_id ) {
+         t_id = &db.create<chain::table_id_object>( [&]( auto& t ) {
+            t.code  = ME;
+            t.scope = scope;
+            t.table = table;
+            t.payer = ME;
+         });
+         ram += config::billable_size_v<chain::table_id_object>;
+      }
+      db.create<chain::key_value_object>( [&]( auto& o ) {
+         o.t_id        = t_id->id;
+         o.primary_key = primary;
+         o.payer       = ME;
+         o.value.assign( data.data(), data.size() );
+      });
+      db.modify( *t_id, []( auto& t ) { ++t.count; } );
+      control->get_mutable_resource_limits_manager().add_pending_ram_usage( ME, ram );
+   }
+
+   // removes a contract row directly from the chain database, to reproduce state written by
+   // older versions of the contract
+   void erase_row(const account_name& scope, const account_name& table, uint64_t primary) {
+      auto& db = control->mutable_db();
+      const auto* t_id = db.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( ME, scope, table ) );
+      BOOST_REQUIRE( t_id );
+      const auto& idx = db.get_index<chain::key_value_index, chain::by_scope_primary>();
+      auto itr = idx.find( boost::make_tuple( t_id->id, primary ) );
+      BOOST_REQUIRE( itr != idx.end() );
+      int64_t ram = itr->value.size() + config::billable_size_v<chain::key_value_object>;
+      db.remove( *itr );
+      db.modify( *t_id, []( auto& t ) { --t.count; } );
+      control->get_mutable_resource_limits_manager().add_pending_ram_usage( ME, -ram );
+   }
+
+   vector<project_user> get_project_users(const account_name& prjname) {
+      return get_scope_rows<project_user>(prjname, N(projectuser), "project_user");
+   }
+
+   vector<project_manager> get_project_managers(const account_name& prjname) {
+      return get_scope_rows<project_manager>(prjname, N(projectmgr), "project_manager");
+   }
+
+   vector<ledger_entry> get_ledger_entries(const account_name& prjname) {
+      return get_scope_rows<ledger_entry>(prjname, N(entries), "ledger_entry");
+   }
+
+   vector<entry_rollup> get_rollups(const account_name& prjname) {
+      return get_scope_rows<entry_rollup>(prjname, N(rollups), "entry_rollup");
+   }
+
+   optional<project_stats> get_project_stats(const account_name& prjname) {
+      vector<char> data = get_row_by_account( ME, ME, N(projstats), prjname );
+      if( data.empty() )
+         return {};
+      return unpack_row<project_stats>(data, "project_stats");
+   }
+
+   optional<user_key> get_user_key(const account_name& user) {
+      vector<char> data = get_row_by_account( ME, ME, N(userkeys), user );
+      if( data.empty() )
+         return {};
+      return unpack_row<user_key>(data, "user_key");
+   }
+
+   optional<period_commit> get_period(const account_name& prjname, uint32_t period) {
+      vector<char> data = get_row_by_account( ME, prjname, N(periods), account_name(period) );
+      if( data.empty() )
+         return {};
+      return unpack_row<period_commit>(data, "period_commit");
+   }
+
+   optional<account_name> get_payroll_cursor(const account_name& prjname) {
+      vector<char> data = get_row_by_account( ME, prjname, N(payrollcur), N(payrollcur) );
+      if( data.empty() )
+         return {};
+      return fc::raw::unpack<account_name>(data);
+   }
+
+   asset get_internal_balance( const account_name& act, symbol balance_symbol = symbol{CORE_SYM} ) {
+      vector<char> data = get_row_by_account( ME, act, N(accounts), balance_symbol.to_symbol_code().value );
+      return data.empty() ? asset(0, balance_symbol) : unpack_row<internal_account>(data, "account").balance;
+   }
+
+};
+
+// Fixture that starts from a chain built once per test run: system and token contracts,
+// horuspay deployed, accounts own1, mgr1, mgr2 and user1..user3, and a USD currency on
+// eosio.token with 1000.0000 USD issued to own1. Cases using it must not recreate these.
+struct horuspay_snapshot_tester : horuspay_tester {
+
+   static const fc::variant& base_snapshot() {
+      static const fc::variant snapshot = []() {
+         horuspay_tester chain;
+         for( auto account : { N(own1), N(mgr1), N(mgr2), N(user1), N(user2), N(user3) } ) {
+            chain.create_account_with_resources(account, system_account_name);
+         }
+         chain.create_currency(N(eosio.token), system_account_name, asset::from_string("1000000.0000 USD"));
+         chain.issue(N(own1), asset::from_string("1000.0000 USD"));
+         return chain.write_snapshot();
+      }();
+      return snapshot;
+   }
+
+   horuspay_snapshot_tester() : horuspay_tester(setup_level::none) {
+      restore_snapshot( base_snapshot() );
+   }
+};
+
+// Fixture for contract logic only: the token contract and horuspay on a chain without the
+// system contract, so there is no RAM market or staking and every account is unlimited.
+// System-level accounting stays with horuspay_tester.
+struct horuspay_light_tester : horuspay_tester {
+
+   horuspay_light_tester() : horuspay_tester(setup_level::minimal) {
+      create_account( ME, config::system_account_name, false, true );
+      produce_block();
+
+      set_code( ME, contracts::horuspay_wasm() );
+      set_abi( ME, contracts::horuspay_abi().data() );
+      produce_block();
+
+      load_abi( ME, horuspay_abi );
+   }
+
+   // Same signature as eosio_system_tester so test cases run unchanged on either fixture
+   transaction_trace_ptr create_account_with_resources( account_name a, account_name creator, uint32_t ram_bytes = 8000 ) {
+      return create_account( a, creator );
+   }
+};
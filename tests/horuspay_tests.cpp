@@ -1,305 +1,4 @@
-#include <boost/test/unit_test.hpp>
-#include <eosio/chain/wast_to_wasm.hpp>
-#include <eosio/chain/permission_object.hpp>
-#include <eosio/chain/trace.hpp>
-#include <cstdlib>
-#include <iostream>
-#include <array>
-#include <utility>
-#include <fc/log/logger.hpp>
-#include <fc/io/raw.hpp>
-#include <fc/crypto/hex.hpp>
-#include <fc/crypto/sha256.hpp>
-#include <fc/crypto/signature.hpp>
-#include <eosio/chain/exceptions.hpp>
-#include <Runtime/Runtime.h>
-
-#include "eosio.system_tester.hpp"
-
-using namespace eosio_system;
-using namespace eosio;
-using namespace std;
-using namespace fc::crypto;
-
-using eosio::chain::action_trace;
-
-const static account_name ME = account_name("horuspay");
-const static symbol core_symbol = symbol{CORE_SYM};
-const static name system_account_name = eosio::chain::config::system_account_name;
-
-struct eosio_assert_message_is_log {
-   eosio_assert_message_is_log( const string& msg )
-         : expected( "assertion failure with message: " ) {
-      expected.append( msg );
-      std::cout << "eosio_assert_message_is_log (contructor): " << msg << std::endl;
-   }
-
-   bool operator()( const eosio_assert_message_exception& ex ) {
-      std::cout << "operator(): [" << ex.to_string() << "]|[" << expected << "]" << std::endl;
-      return ex.to_string() == expected;
-   }
-
-   string expected;
-};
-
-
-struct project {
-   name           name;
-   extended_asset hourly_rate;
-   extended_asset balance;
-};
-FC_REFLECT( project, (name)(hourly_rate)(balance));
-
-struct project_user {
-   uint64_t             id;
-   name                 project;
-   name                 user;
-   int64_t              pending;
-   extended_asset       hourly_rate;
-   block_timestamp_type last_clock;
-};
-FC_REFLECT( project_user, (id)(project)(user)(pending)(hourly_rate)(last_clock));
-
-struct project_manager {
-   uint64_t id;
-   name     project;
-   name     manager;
-   bool     is_owner;
-};
-FC_REFLECT( project_manager, (id)(project)(manager)(is_owner));
-
-
-struct horuspay_tester : eosio_system_tester {
-   
-   abi_serializer horuspay_abi; 
-
-   bool print_console = false;
-   void set_print_console(bool value) {
-      print_console = value;
-   }
-
-   void print_debug(const action_trace& ar) {
-      if (!ar.console.empty()) {
-         cout << ": CONSOLE OUTPUT BEGIN =====================" << endl
-            << ar.console << endl
-            << ": CONSOLE OUTPUT END   =====================" << endl;
-      }
-      // for(const auto& it : ar.inline_traces) {
-      //    print_debug(it);
-      // }
-   }
-
-   horuspay_tester() {
-
-      create_account_with_resources(ME, system_account_name, 1500000);
-      transfer(system_account_name, ME, core_sym::from_string("100.0000"));
-
-      // // const auto& db  = control->db();
-      // // auto me_active = db.get<permission_object, eosio::chain::by_owner>( boost::make_tuple(ME, name("active")) );
-
-      auto trace_auth = TESTER::push_action(system_account_name, updateauth::get_name(), ME, mvo()
-                                            ("account", ME)
-                                            ("permission", name("active"))
-                                            ("parent", name("owner"))
-                                            ("auth",authority(1,{ key_weight{get_public_key( ME, "active" ), 1}}, {permission_level_weight{{ME, name("eosio.code")}, 1}})
-                                            )
-      );
-      // BOOST_REQUIRE_EQUAL(transaction_receipt::executed, trace_auth->receipt->status);
-      produce_block();
-
-      set_code( ME, contracts::horuspay_wasm());
-      set_abi( ME, contracts::horuspay_abi().data() );
-
-      const auto& accnt = control->db().get<account_object,by_name>(ME);
-      abi_def abi;
-      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
-      horuspay_abi.set_abi(abi, abi_serializer_max_time);
-   }
-   
-   transaction_trace_ptr last_tx_trace;
-   typename base_tester::action_result my_push_action(action&& act, uint64_t authorizer) {
-      signed_transaction trx;
-      if (authorizer) {
-         act.authorization = vector<permission_level>{{authorizer, name("active")}};
-      }
-      trx.actions.emplace_back(std::move(act));
-      set_transaction_headers(trx);
-      if (authorizer) {
-         trx.sign(get_private_key(authorizer, "active"), control->get_chain_id());
-      }
-      try {
-         last_tx_trace = push_transaction(trx);
-         if(print_console) {
-            print_debug(last_tx_trace->action_traces[0]);
-         }
-      } catch (const fc::exception& ex) {
-         if(print_console) {
-            cout << "-----EXCEPTION------" << endl
-                 << fc::json::to_string(ex) << endl;
-         }
-         edump((ex));
-         edump((ex.to_detail_string()));
-         return error(ex.top_message()); // top_message() is assumed by many tests; otherwise they fail
-      }
-      produce_block();
-      BOOST_REQUIRE_EQUAL(true, chain_has_transaction(trx.id()));
-      return success();
-   }
-
-   action_result call( const account_name& signer, const action_name &name, const variant_object &data ) {
-         
-      string action_type_name = horuspay_abi.get_action_type(name);
-
-      action act;
-      act.account = ME;
-      act.name    = name;
-      act.data    = horuspay_abi.variant_to_binary( action_type_name, data, abi_serializer_max_time );
-      return my_push_action(std::move(act), signer);
-   }
-
-   action_result create(account_name project, account_name owner, extended_asset hourly_rate) {
-      return call(ME, N(create),mvo()
-         ("project",     project)
-         ("owner",       owner)
-         ("hourly_rate", hourly_rate)
-      );
-   }
-
-   action_result adduser(account_name project, account_name manager, account_name user) {
-      return call(manager, N(adduser), mvo()
-         ("project",  project)
-         ("manager",  manager)
-         ("user",     user)
-      );
-   }
-
-   action_result removeuser(account_name project, account_name manager, account_name user) {
-      return call(manager, N(removeuser), mvo()
-         ("project",  project)
-         ("manager",  manager)
-         ("user",     user)
-      );
-   }
-
-   action_result addmanager(account_name project, account_name owner, account_name manager) {
-      return call(owner, N(addmanager), mvo()
-         ("project", project)
-         ("owner",   owner)
-         ("manager", manager)
-      );
-   }
-
-   action_result rmvmanager(account_name project, account_name owner, account_name manager) {
-      return call(owner, N(rmvmanager), mvo()
-         ("project", project)
-         ("owner",   owner)
-         ("manager", manager)
-      );
-   }
-
-   action_result clockin(account_name project, account_name user) {
-      return call(user, N(clockin), mvo()
-         ("project", project)
-         ("user",    user)
-      );
-   }
-
-   action_result clockout(account_name project, account_name user, optional<string> description) {
-      return call(user, N(clockout), mvo()
-         ("project",     project)
-         ("user",        user)
-         ("description", description)
-      );
-   }
-
-   action_result addtime(account_name project, account_name user, uint64_t seconds, optional<string> description, optional<account_name> manager) {
-      return call(user, N(addtime), mvo()
-         ("project",     project)
-         ("user",        user)
-         ("seconds",     seconds)
-         ("description", description)
-         ("manager",     manager)
-      );
-   }
-
-   action_result approve(account_name project, account_name manager, account_name user, optional<int64_t> seconds) {
-      return call(manager, N(approve), mvo()
-         ("project",     project)
-         ("manager",     manager)
-         ("user",        user)
-         ("seconds",       seconds)
-      );
-   }
-
-   action_result decline(account_name project, account_name manager, account_name user, int64_t seconds) {
-      return call(manager, N(decline), mvo()
-         ("project",     project)
-         ("manager",     manager)
-         ("user",        user)
-         ("seconds",       seconds)
-      );
-   }
-
-   action_result setuserrate(account_name project, account_name manager, account_name user, extended_asset hourly_rate) {
-      return call(manager, N(setuserrate), mvo()
-         ("project",     project)
-         ("manager",     manager)
-         ("user",        user)
-         ("hourly_rate", hourly_rate)
-      );
-   }
-
-   action_result setprjrate(account_name project, account_name manager, account_name user, extended_asset hourly_rate) {
-      return call(manager, N(setuserrate), mvo()
-         ("project",     project)
-         ("manager",     manager)
-         ("user",        user)
-         ("hourly_rate", hourly_rate)
-      );
-   }
-
-   void transfer_with_memo( name from, name to, const asset& amount, const string& memo = "", name token_contract=N(eosio.token) ) {
-      last_tx_trace = base_tester::push_action( token_contract, N(transfer), from, mutable_variant_object()
-                                ("from",     from)
-                                ("to",       to )
-                                ("quantity", amount)
-                                ("memo",     memo)
-                                );
-      print_debug(last_tx_trace->action_traces[0]);
-   }
-
-   optional<project> get_project(const account_name& prjname) {
-      vector<char> data = get_row_by_account( ME, ME, N(project), prjname );
-      if( data.empty() )
-         return {};
-      std::cout << "get_row_by_account: " << fc::to_hex(data) << std::endl;
-      return horuspay_abi.binary_to_variant("project", data, abi_serializer_max_time).as<project>();
-   }
-
-   optional<project_manager> get_project_manager(uint64_t id) {
-      vector<char> data = get_row_by_account( ME, ME, N(projectmgr), id );
-      if( data.empty() )
-         return {};
-
-      std::cout << "get_project_manager: " << fc::to_hex(data) << std::endl;
-      return horuspay_abi.binary_to_variant("project_manager", data, abi_serializer_max_time).as<project_manager>();
-   }
-
-   optional<project_user> get_project_user(uint64_t id) {
-      vector<char> data = get_row_by_account( ME, ME, N(projectuser), id );
-      if( data.empty() )
-         return {};
-
-      std::cout << "get_project_user: " << fc::to_hex(data) << std::endl;
-      return horuspay_abi.binary_to_variant("project_user", data, abi_serializer_max_time).as<project_user>();
-   }
-
-   asset get_internal_balance( const account_name& act, symbol balance_symbol = symbol{CORE_SYM} ) {
-      vector<char> data = get_row_by_account( ME, act, N(accounts), balance_symbol.to_symbol_code().value );
-      return data.empty() ? asset(0, balance_symbol) : horuspay_abi.binary_to_variant("account", data, abi_serializer_max_time)["balance"].as<asset>();
-   }
-
-};
+#include "horuspay_tester.hpp"
 
 BOOST_AUTO_TEST_SUITE(horuspay_tests)
 
@@ -340,6 +39,13 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( wasm_assert_msg("A project with that name already exists")
       , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
 
+   // User balances are per symbol code: USD can only be paid from the contract it was first used with
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("symbol is already paid from another token contract")
+      , create(N(proj9), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(faketoken))));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("symbol is already paid from another token contract")
+      , create(N(proj9), N(own1), extended_asset(asset::from_string("10.00 USD"), N(eosio.token))));
+
    auto prj = get_project(N(proj1));
    BOOST_REQUIRE(!!prj);
 
@@ -377,9 +83,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is not member of the project")
       , removeuser(N(proj1), N(own1), N(user3)));
 
-   auto prjmgr = get_project_manager(uint64_t(0));
+   auto prjmgr = get_project_manager(N(proj1), N(own1));
    BOOST_REQUIRE(!!prjmgr);
-   BOOST_REQUIRE_EQUAL(prjmgr->project, N(proj1));
    BOOST_REQUIRE_EQUAL(prjmgr->manager, N(own1));
    BOOST_REQUIRE_EQUAL(prjmgr->is_owner, true);
 
@@ -390,9 +95,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
       , addmanager(N(proj1), N(own1), N(mgr1)));
    
-   prjmgr = get_project_manager(uint64_t(1));
+   prjmgr = get_project_manager(N(proj1), N(mgr1));
    BOOST_REQUIRE(!!prjmgr);
-   BOOST_REQUIRE_EQUAL(prjmgr->project, N(proj1));
    BOOST_REQUIRE_EQUAL(prjmgr->manager, N(mgr1));
    BOOST_REQUIRE_EQUAL(prjmgr->is_owner, false);
 
@@ -405,9 +109,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
       , addmanager(N(proj1), N(own1), N(mgr2)));
 
-   prjmgr = get_project_manager(uint64_t(2));
+   prjmgr = get_project_manager(N(proj1), N(mgr2));
    BOOST_REQUIRE(!!prjmgr);
-   BOOST_REQUIRE_EQUAL(prjmgr->project, N(proj1));
    BOOST_REQUIRE_EQUAL(prjmgr->manager, N(mgr2));
    BOOST_REQUIRE_EQUAL(prjmgr->is_owner, false);
 
@@ -437,10 +140,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
       , clockin(N(proj1), N(user1)));
 
-   auto prjusr = get_project_user(uint64_t(0));
+   auto prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending,0);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, block_timestamp_type(control->head_block_time()).slot);
@@ -453,11 +154,9 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( wasm_assert_msg("must clockin first")
       , clockout(N(proj1), N(user1), {}));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
 
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending, 2*60*60);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
@@ -474,10 +173,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
       , clockout(N(proj1), N(user1), {}));
    
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending, 5*60*60);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
@@ -495,10 +192,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
       , addtime(N(proj1), N(user1), 6*3600, "work on yyy", {}));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending, (5+7)*60*60);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
@@ -524,9 +219,30 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EXCEPTION( transfer_with_memo( name("mgr1"), ME, asset::from_string("10.0000 ARS"), "proj1" ),
          eosio_assert_message_exception, eosio_assert_message_is( "invalid deposit token" ) );
 
+   // Transfers that are not deposits are accepted without touching any project
+   transfer_with_memo( name("mgr1"), ME, asset::from_string("1.0000 ARS"), "" );
+   transfer_with_memo( name("mgr1"), ME, asset::from_string("1.0000 ARS"), "Thanks!" );
+   transfer_with_memo( name("mgr1"), ME, asset::from_string("10.0000 USD"), "proj1", name("faketoken") );
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_project(N(proj1))->balance.quantity );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("token contract already allowed")
+      , addtoken(N(eosio.token)));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtoken(N(faketoken)));
+
    BOOST_REQUIRE_EXCEPTION( transfer_with_memo( name("mgr1"), ME, asset::from_string("10.0000 USD"), "proj1", name("faketoken") ),
          eosio_assert_message_exception, eosio_assert_message_is( "invalid deposit contract" ) );
 
+   BOOST_REQUIRE_EQUAL( success()
+      , rmvtoken(N(faketoken)));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("token contract not allowed")
+      , rmvtoken(N(faketoken)));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("token contract is used by a project")
+      , rmvtoken(N(eosio.token)));
+
    transfer_with_memo( name("mgr1"), ME, asset::from_string("10.0000 USD"), "proj1" );
 
    // Approve
@@ -539,13 +255,36 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
    , approve(N(proj1), N(mgr1), N(user1),1*3600));
 
+   // Approved pay is credited to the internal ledger until withdrawn
+   BOOST_REQUIRE_EQUAL( asset::from_string("10.0000 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("10.0000 USD"), get_balance(ME, symbol{4,"USD"}));
+
+   // Withdraw
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("must withdraw positive quantity")
+   , withdraw(N(user1), asset::from_string("0.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("no balance to withdraw")
+   , withdraw(N(user2), asset::from_string("1.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("overdrawn balance")
+   , withdraw(N(user1), asset::from_string("11.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( success()
+   , withdraw(N(user1), asset::from_string("4.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("6.0000 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("4.0000 USD"), get_balance(N(user1), symbol{4,"USD"}));
+
+   BOOST_REQUIRE_EQUAL( success()
+   , withdraw(N(user1), asset::from_string("6.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
    BOOST_REQUIRE_EQUAL( asset::from_string("10.0000 USD"), get_balance(N(user1), symbol{4,"USD"}));
    BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_balance(ME, symbol{4,"USD"}));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending, (5+7-1)*60*60);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
@@ -561,13 +300,14 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
    , approve(N(proj1), N(mgr1), N(user1), {}));
 
+   BOOST_REQUIRE_EQUAL( success()
+   , withdraw(N(user1), asset::from_string("110.0000 USD")));
+
    BOOST_REQUIRE_EQUAL( asset::from_string("120.0000 USD"), get_balance(N(user1), symbol{4,"USD"}));
    BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_balance(ME, symbol{4,"USD"}));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending, 0);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
@@ -595,16 +335,20 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( wasm_assert_msg("hourly rate asset/contract should be the same as project")
    , setuserrate(N(proj1), N(mgr1), N(user1), extended_asset(asset::from_string("10.0000 USD"), N(faketoken))));
 
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("Hourly rate must be positive")
+   , setuserrate(N(proj1), N(mgr1), N(user1), extended_asset(asset::from_string("0.0000 USD"), N(eosio.token))));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("Hourly rate must be positive")
+   , setuserrate(N(proj1), N(mgr1), N(user1), extended_asset(asset::from_string("-10.0000 USD"), N(eosio.token))));
+
    BOOST_REQUIRE_EQUAL( success()
    , setuserrate(N(proj1), N(mgr1), N(user1), extended_asset(asset::from_string("20.0000 USD"), N(eosio.token))));
 
    BOOST_REQUIRE_EQUAL( success()
       , clockin(N(proj1), N(user1)));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending,0);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, block_timestamp_type(control->head_block_time()).slot);
@@ -614,10 +358,8 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
       , clockout(N(proj1), N(user1), {}));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending,2*3600);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
@@ -639,17 +381,1281 @@ BOOST_FIXTURE_TEST_CASE( test_all, horuspay_tester ) try {
    BOOST_REQUIRE_EQUAL( success()
    , approve(N(proj1), N(mgr1), N(user1), 1*3600));
 
+   BOOST_REQUIRE_EQUAL( success()
+   , withdraw(N(user1), asset::from_string("20.0000 USD")));
+
    BOOST_REQUIRE_EQUAL( asset::from_string("140.0000 USD"), get_balance(N(user1), symbol{4,"USD"}));
    BOOST_REQUIRE_EQUAL( asset::from_string("80.0000 USD"), get_balance(ME, symbol{4,"USD"}));
 
-   prjusr = get_project_user(uint64_t(0));
+   prjusr = get_project_user(N(proj1), N(user1));
    BOOST_REQUIRE(!!prjusr);
-   BOOST_REQUIRE_EQUAL(prjusr->id,0);
-   BOOST_REQUIRE_EQUAL(prjusr->project,N(proj1));
    BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
    BOOST_REQUIRE_EQUAL(prjusr->pending,0);
    BOOST_REQUIRE_EQUAL(prjusr->last_clock.slot, 0);
 
+   // Batch approve
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user2)));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 2*3600, {}, {}));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 3*3600, {}, {}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to approve")
+   , batchapprove(N(proj1), N(mgr1), {}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("only managers can approve hours")
+   , batchapprove(N(proj1), N(mgr2), {{N(user1), {}}}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is not a member of the project")
+   , batchapprove(N(proj1), N(mgr1), {{N(user1), {}}, {N(user3), {}}}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("0 < approve <= pending")
+   , batchapprove(N(proj1), N(mgr1), {{N(user1), 3*3600}}));
+
+   transfer_with_memo( name("mgr1"), ME, asset::from_string("10.0000 USD"), "proj1" );
+
+   // user1: 2h @ 20 USD, user2: 3h @ 10 USD => 70 USD, only 90 USD deposited
+   BOOST_REQUIRE_EQUAL( success()
+   , batchapprove(N(proj1), N(mgr1), {{N(user1), 1*3600}, {N(user2), {}}, {N(user1), {}}}));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("40.0000 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("30.0000 USD"), get_internal_balance(N(user2), symbol{4,"USD"}));
+
+   BOOST_REQUIRE_EQUAL( success()
+   , withdraw(N(user1), asset::from_string("40.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( success()
+   , withdraw(N(user2), asset::from_string("30.0000 USD")));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("180.0000 USD"), get_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("30.0000 USD"), get_balance(N(user2), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("20.0000 USD"), get_balance(ME, symbol{4,"USD"}));
+
+   prjusr = get_project_user(N(proj1), N(user2));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->user,N(user2));
+   BOOST_REQUIRE_EQUAL(prjusr->pending,0);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 3*3600, {}, {}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("not enough funds")
+   , batchapprove(N(proj1), N(mgr1), {{N(user2), {}}}));
+
+   // Bulk time import
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to add")
+      , addtimes(N(proj1), N(mgr1), {}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("not a manager of the project")
+      , addtimes(N(proj1), N(user1), {std::make_tuple(N(user1), 3600, optional<string>())}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("seconds must be positive")
+      , addtimes(N(proj1), N(mgr1), {std::make_tuple(N(user1), 0, optional<string>())}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is not a member of the project")
+      , addtimes(N(proj1), N(mgr1), {std::make_tuple(N(user1), 3600, optional<string>()), std::make_tuple(N(user3), 3600, optional<string>())}));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtimes(N(proj1), N(mgr1), {
+         std::make_tuple(N(user1), 1*3600, optional<string>("monday")),
+         std::make_tuple(N(user2), 1800,   optional<string>()),
+         std::make_tuple(N(user1), 2*3600, optional<string>("tuesday"))
+      }));
+
+   prjusr = get_project_user(N(proj1), N(user1));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->user,N(user1));
+   BOOST_REQUIRE_EQUAL(prjusr->pending,3*3600);
+
+   prjusr = get_project_user(N(proj1), N(user2));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->user,N(user2));
+   BOOST_REQUIRE_EQUAL(prjusr->pending,3*3600+1800);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( project_user_row_size, horuspay_tester ) try {
+
+   create_account_with_resources(N(user1), system_account_name);
+   create_account_with_resources(N(user2), system_account_name);
+   create_account_with_resources(N(own1), system_account_name);
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+
+   // First member also pays for the projectuser table of the project scope
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+
+   const auto& rlm = control->get_resource_limits_manager();
+   int64_t ram_before = rlm.get_account_ram_usage(ME);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user2)));
+
+   int64_t ram_per_member = rlm.get_account_ram_usage(ME) - ram_before;
+   int64_t row_size = get_row_by_account( ME, N(proj1), N(projectuser), N(user2) ).size();
+
+   BOOST_REQUIRE_EQUAL( row_size, 30 );
+   BOOST_REQUIRE_EQUAL( ram_per_member, row_size + int64_t(config::billable_size_v<key_value_object>) );
+
+   legacy_project_user legacy{ 1, N(proj1), N(user2), 0, extended_asset(asset::from_string("10.0000 USD"), N(eosio.token)), block_timestamp_type() };
+   int64_t legacy_row_size = fc::raw::pack_size(legacy);
+   int64_t legacy_ram_per_member = legacy_row_size
+                                 + config::billable_size_v<key_value_object>
+                                 + config::billable_size_v<index128_object>;
+
+   BOOST_TEST_MESSAGE( "projectuser bytes per member: row " << legacy_row_size << " -> " << row_size
+                       << ", billed RAM " << legacy_ram_per_member << " -> " << ram_per_member );
+
+   BOOST_REQUIRE_EQUAL( legacy_row_size, 60 );
+   BOOST_REQUIRE( ram_per_member < legacy_ram_per_member );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( approve_carry, horuspay_tester ) try {
+
+   create_account_with_resources(N(user1), system_account_name);
+   create_account_with_resources(N(own1), system_account_name);
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+   issue(name("own1"), asset::from_string("100.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("20.0000 USD"), N(eosio.token))));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+
+   transfer_with_memo( name("own1"), ME, asset::from_string("10.0000 USD"), "proj1" );
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 2, {}, {}));
+
+   // 1s @ 200000 sub-units/h = 200000 / 3600 = 55.55 sub-units: 55 paid, 2000 sub-unit seconds carried
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(own1), N(user1), 1));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0055 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+
+   auto prjusr = get_project_user(N(proj1), N(user1));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->pending, 1);
+   BOOST_REQUIRE_EQUAL(prjusr->carry, 2000);
+
+   // 2s in two approvals pay the same 111 sub-units as one approval of 2s
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(own1), N(user1), {}));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0111 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+
+   prjusr = get_project_user(N(proj1), N(user1));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->pending, 0);
+   BOOST_REQUIRE_EQUAL(prjusr->carry, 400);
+
+   auto prj = get_project(N(proj1));
+   BOOST_REQUIRE(!!prj);
+   BOOST_REQUIRE_EQUAL(prj->balance.quantity, asset::from_string("9.9889 USD"));
+
+   // Pay that does not fit in 64 bits is rejected instead of wrapping around
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("payment amount out of range")
+      , addtime(N(proj1), N(user1), 4000000000000000000ull, {}, {}));
+
+   // Reports CPU per approve; set HORUSPAY_BASELINE_WASM/ABI to a build of an earlier
+   // revision (e.g. the double based payment) to measure it side by side
+   auto approve_cpu = [&]( const account_name& contract ) {
+      base_tester::push_action( contract, N(create), contract, mvo()
+         ("project",     "bench")
+         ("owner",       "own1")
+         ("hourly_rate", extended_asset(asset::from_string("20.0000 USD"), N(eosio.token)))
+      );
+      base_tester::push_action( contract, N(adduser), N(own1), mvo()
+         ("project", "bench")
+         ("manager", "own1")
+         ("user",    "user1")
+      );
+      transfer_with_memo( name("own1"), contract, asset::from_string("20.0000 USD"), "bench" );
+
+      vector<int64_t> elapsed;
+      for( int i = 0; i < 25; ++i ) {
+         base_tester::push_action( contract, N(addtime), N(user1), mvo()
+            ("project",     "bench")
+            ("user",        "user1")
+            ("seconds",     1337)
+            ("description", variant())
+            ("manager",     variant())
+         );
+         produce_block();
+         auto trace = base_tester::push_action( contract, N(approve), N(own1), mvo()
+            ("project", "bench")
+            ("manager", "own1")
+            ("user",    "user1")
+            ("seconds", variant())
+         );
+         produce_block();
+         elapsed.push_back( trace->action_traces[0].elapsed.count() );
+      }
+      std::sort( elapsed.begin(), elapsed.end() );
+      return elapsed[elapsed.size() / 2];
+   };
+
+   BOOST_TEST_MESSAGE( "approve median elapsed: " << approve_cpu(ME) << " us" );
+
+   const char* baseline_wasm = std::getenv("HORUSPAY_BASELINE_WASM");
+   const char* baseline_abi  = std::getenv("HORUSPAY_BASELINE_ABI");
+   if( baseline_wasm && baseline_abi ) {
+      deploy_horuspay( N(horuspaybase), read_wasm(baseline_wasm), read_abi(baseline_abi) );
+      BOOST_TEST_MESSAGE( "baseline approve median elapsed: " << approve_cpu(N(horuspaybase)) << " us" );
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( paged_payroll, horuspay_snapshot_tester ) try {
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+
+   for( auto user : {N(user1), N(user2), N(user3)} ) {
+      BOOST_REQUIRE_EQUAL( success()
+         , adduser(N(proj1), N(own1), user));
+      BOOST_REQUIRE_EQUAL( success()
+         , addtime(N(proj1), user, 3600, {}, {}));
+   }
+
+   transfer_with_memo( name("own1"), ME, asset::from_string("25.0000 USD"), "proj1" );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("max_rows must be positive")
+      , runpayroll(N(proj1), N(own1), 0));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("only managers can approve hours")
+      , runpayroll(N(proj1), N(user1), 2));
+
+   // First page pays user1 and user2 and leaves the cursor on user3
+   BOOST_REQUIRE_EQUAL( success()
+      , runpayroll(N(proj1), N(own1), 2));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("10.0000 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("10.0000 USD"), get_internal_balance(N(user2), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_internal_balance(N(user3), symbol{4,"USD"}));
+
+   auto cursor = get_payroll_cursor(N(proj1));
+   BOOST_REQUIRE(!!cursor);
+   BOOST_REQUIRE_EQUAL(*cursor, N(user3));
+
+   // Rows added behind the cursor wait for the next run
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 3600, {}, {}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("not enough funds")
+      , runpayroll(N(proj1), N(own1), 2));
+
+   transfer_with_memo( name("own1"), ME, asset::from_string("15.0000 USD"), "proj1" );
+
+   BOOST_REQUIRE_EQUAL( success()
+      , runpayroll(N(proj1), N(own1), 2));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("10.0000 USD"), get_internal_balance(N(user3), symbol{4,"USD"}));
+   BOOST_REQUIRE(!get_payroll_cursor(N(proj1)));
+
+   auto prjusr = get_project_user(N(proj1), N(user1));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->pending, 3600);
+
+   // A new run starts again from the first user
+   BOOST_REQUIRE_EQUAL( success()
+      , runpayroll(N(proj1), N(own1), 1));
+
+   BOOST_REQUIRE_EQUAL( asset::from_string("20.0000 USD"), get_internal_balance(N(user1), symbol{4,"USD"}));
+   BOOST_REQUIRE_EQUAL( asset::from_string("0.0000 USD"), get_project(N(proj1))->balance.quantity);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( project_stats_counters, horuspay_snapshot_tester ) try {
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("20.0000 USD"), N(eosio.token))));
+
+   auto stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE(!!stats);
+   BOOST_REQUIRE_EQUAL(stats->managers, 1);
+   BOOST_REQUIRE_EQUAL(stats->members, 0);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("0.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addmanager(N(proj1), N(own1), N(mgr1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user2)));
+
+   // Clocking in twice counts once
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user1)));
+
+   stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE_EQUAL(stats->managers, 2);
+   BOOST_REQUIRE_EQUAL(stats->members, 2);
+   BOOST_REQUIRE_EQUAL(stats->clocked_in, 1);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 2*3600, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtimes(N(proj1), N(mgr1), {{N(user1), 1800, {}}, {N(user1), 1, {}}}));
+
+   // 1801s @ 20.0000 USD/h = 10.0055 USD (rounded down)
+   stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE_EQUAL(stats->pending, 2*3600 + 1801);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("50.0055 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , decline(N(proj1), N(mgr1), N(user2), 3600));
+   BOOST_REQUIRE_EQUAL( success()
+      , setuserrate(N(proj1), N(mgr1), N(user2), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+
+   stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE_EQUAL(stats->pending, 3600 + 1801);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("20.0055 USD"));
+
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "proj1" );
+
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(mgr1), N(user1), 1));
+   BOOST_REQUIRE_EQUAL( success()
+      , runpayroll(N(proj1), N(mgr1), 10));
+
+   stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE_EQUAL(stats->pending, 0);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("0.0000 USD"));
+
+   // Removing a clocked-in member releases its clocked_in slot
+   BOOST_REQUIRE_EQUAL( success()
+      , removeuser(N(proj1), N(mgr1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , rmvmanager(N(proj1), N(own1), N(mgr1)));
+
+   stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE_EQUAL(stats->members, 1);
+   BOOST_REQUIRE_EQUAL(stats->managers, 1);
+   BOOST_REQUIRE_EQUAL(stats->clocked_in, 0);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( project_stats_rebuilt_when_missing, horuspay_snapshot_tester ) try {
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("20.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , addmanager(N(proj1), N(own1), N(mgr1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user2)));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 3600, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user2)));
+
+   // A project created before the stats table has no row
+   erase_row(ME, N(projstats), N(proj1));
+   BOOST_REQUIRE(!get_project_stats(N(proj1)));
+
+   // The next action counts it from the project tables, including its own change
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 1800, {}, {}));
+
+   auto stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE(!!stats);
+   BOOST_REQUIRE_EQUAL(stats->members, 2);
+   BOOST_REQUIRE_EQUAL(stats->managers, 2);
+   BOOST_REQUIRE_EQUAL(stats->clocked_in, 1);
+   BOOST_REQUIRE_EQUAL(stats->pending, 5400);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("30.0000 USD"));
+
+   // and later actions update it as usual
+   BOOST_REQUIRE_EQUAL( success()
+      , decline(N(proj1), N(mgr1), N(user1), 1800));
+
+   stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE_EQUAL(stats->pending, 3600);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("20.0000 USD"));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( project_member_listing, horuspay_snapshot_tester ) try {
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj2), N(mgr1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user3)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj2), N(mgr1), N(user2)));
+   BOOST_REQUIRE_EQUAL( success()
+      , addmanager(N(proj1), N(own1), N(mgr1)));
+
+   // Each project scope holds only its own members, ordered by user
+   auto users = get_project_users(N(proj1));
+   BOOST_REQUIRE_EQUAL(users.size(), 2);
+   BOOST_REQUIRE_EQUAL(users[0].user, N(user1));
+   BOOST_REQUIRE_EQUAL(users[1].user, N(user3));
+
+   users = get_project_users(N(proj2));
+   BOOST_REQUIRE_EQUAL(users.size(), 1);
+   BOOST_REQUIRE_EQUAL(users[0].user, N(user2));
+
+   auto managers = get_project_managers(N(proj1));
+   BOOST_REQUIRE_EQUAL(managers.size(), 2);
+   BOOST_REQUIRE_EQUAL(managers[0].manager, N(mgr1));
+   BOOST_REQUIRE_EQUAL(managers[1].manager, N(own1));
+   BOOST_REQUIRE(managers[1].is_owner);
+
+   // A page of members is a bounded range of the scope
+   users = get_scope_rows<project_user>(N(proj1), N(projectuser), "project_user", N(user2).to_uint64_t(), N(user4).to_uint64_t());
+   BOOST_REQUIRE_EQUAL(users.size(), 1);
+   BOOST_REQUIRE_EQUAL(users[0].user, N(user3));
+
+   BOOST_REQUIRE(get_project_users(N(proj3)).empty());
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( switch_clock, horuspay_snapshot_tester ) try {
+
+   const auto rate = extended_asset(asset::from_string("10.0000 USD"), N(eosio.token));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), rate));
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj2), N(own1), rate));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj2), N(own1), N(user1)));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("source and target projects must differ")
+      , switchclock(N(proj1), N(proj1), N(user1), {}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("must clockin first")
+      , switchclock(N(proj1), N(proj2), N(user1), {}));
+
+   auto clocked_in = control->pending_block_time();
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user1)));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is not a member of the target project")
+      , switchclock(N(proj1), N(proj3), N(user1), {}));
+
+   produce_blocks(20);
+
+   auto switched = control->pending_block_time();
+   BOOST_REQUIRE_EQUAL( success()
+      , switchclock(N(proj1), N(proj2), N(user1), string("moving to proj2")));
+
+   // The source session ends exactly where the target session starts
+   auto from = get_project_users(N(proj1))[0];
+   BOOST_REQUIRE_EQUAL(from.pending, (switched - clocked_in).to_seconds());
+   BOOST_REQUIRE_EQUAL(from.last_clock.slot, 0);
+
+   auto to = get_project_users(N(proj2))[0];
+   BOOST_REQUIRE_EQUAL(to.pending, 0);
+   BOOST_REQUIRE(to.last_clock.to_time_point() == switched);
+
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->clocked_in, 0);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->pending, from.pending);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->liability, asset::from_string("0.0277 USD"));
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj2))->clocked_in, 1);
+
+   produce_blocks(2);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , clockout(N(proj2), N(user1), {}));
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj2))[0].pending, 1);
+
+   // An open session on the target project is not replaced
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user1)));
+   auto open_session = control->pending_block_time();
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj2), N(user1)));
+
+   produce_blocks(2);
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is already clocked in to the target project")
+      , switchclock(N(proj1), N(proj2), N(user1), {}));
+   BOOST_REQUIRE(get_project_users(N(proj2))[0].last_clock.to_time_point() == open_session);
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj2))[0].pending, 1);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj2))->clocked_in, 1);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( signed_timesheets, horuspay_snapshot_tester ) try {
+
+   using horuspay_actions::timesheet;
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , addmanager(N(proj1), N(own1), N(mgr1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user2)));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("user has no registered key")
+      , addsigned(N(proj1), N(mgr1), {sign_timesheet({N(proj1), N(user1), 3600, 1, 1})}));
+
+   for( auto user : { N(user1), N(user2), N(user3) } ) {
+      BOOST_REQUIRE_EQUAL( success()
+         , setkey(user, get_public_key(user, "active")));
+   }
+   BOOST_REQUIRE_EQUAL(get_user_key(N(user1))->nonce, 0);
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("not a manager of the project")
+      , addsigned(N(proj1), N(mgr2), {sign_timesheet({N(proj1), N(user1), 3600, 1, 1})}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to add")
+      , addsigned(N(proj1), N(mgr1), {}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("timesheet is for another project")
+      , addsigned(N(proj1), N(mgr1), {sign_timesheet({N(proj2), N(user1), 3600, 1, 1})}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is not a member of the project")
+      , addsigned(N(proj1), N(mgr1), {sign_timesheet({N(proj1), N(user3), 3600, 1, 1})}));
+
+   // Signed by someone else, or changed after signing
+   auto result = addsigned(N(proj1), N(mgr1), {sign_timesheet({N(proj1), N(user1), 3600, 1, 1}, N(user2))});
+   BOOST_REQUIRE( result.find("expected key different than recovered key") != string::npos );
+
+   auto tampered = sign_timesheet({N(proj1), N(user1), 3600, 1, 1});
+   tampered.sheet.seconds = 36000;
+   result = addsigned(N(proj1), N(mgr1), {tampered});
+   BOOST_REQUIRE( result.find("expected key different than recovered key") != string::npos );
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addsigned(N(proj1), N(mgr1), {
+         sign_timesheet({N(proj1), N(user1), 3600, 1, 1}),
+         sign_timesheet({N(proj1), N(user2), 600, 1, 1}),
+         sign_timesheet({N(proj1), N(user1), 1800, 2, 2})
+      }));
+
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[0].pending, 5400);
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[1].pending, 600);
+   BOOST_REQUIRE_EQUAL(get_user_key(N(user1))->nonce, 2);
+   BOOST_REQUIRE_EQUAL(get_user_key(N(user2))->nonce, 1);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->pending, 6000);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->liability, asset::from_string("16.6666 USD"));
+
+   // Replays, also inside a batch, are rejected
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("timesheet nonce already used")
+      , addsigned(N(proj1), N(mgr1), {sign_timesheet({N(proj1), N(user1), 1800, 2, 2})}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("timesheet nonce already used")
+      , addsigned(N(proj1), N(mgr1), {
+         sign_timesheet({N(proj1), N(user2), 60, 3, 5}),
+         sign_timesheet({N(proj1), N(user2), 60, 3, 4})
+      }));
+
+   // Changing the key keeps the nonce
+   BOOST_REQUIRE_EQUAL( success()
+      , setkey(N(user1), get_public_key(N(user1), "owner")));
+   BOOST_REQUIRE_EQUAL(get_user_key(N(user1))->nonce, 2);
+   BOOST_REQUIRE(get_user_key(N(user1))->key == get_public_key(N(user1), "owner"));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( merkle_periods, horuspay_snapshot_tester ) try {
+
+   using horuspay_actions::period_entry;
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , addmanager(N(proj1), N(own1), N(mgr1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(mgr1), N(user2)));
+
+   // An odd number of entries, so the last node of a level moves up unpaired
+   vector<period_entry> entries = {
+      { N(user1), 3600, "design" },
+      { N(user2), 1800, "review" },
+      { N(user1),  600, "standup" },
+      { N(user2), 7200, "feature" },
+      { N(user1),   60, "" }
+   };
+   auto levels = merkle_levels(entries);
+   auto root   = levels.back()[0];
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("not a manager of the project")
+      , commitperiod(N(proj1), N(user1), 202642, root, 5, {{N(user1), 4260}, {N(user2), 9000}}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is not a member of the project")
+      , commitperiod(N(proj1), N(mgr1), 202642, root, 5, {{N(user1), 4260}, {N(user3), 9000}}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to commit")
+      , commitperiod(N(proj1), N(mgr1), 202642, root, 5, {}));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , commitperiod(N(proj1), N(mgr1), 202642, root, 5, {{N(user1), 4260}, {N(user2), 9000}}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("period already committed")
+      , commitperiod(N(proj1), N(mgr1), 202642, root, 5, {{N(user1), 1}}));
+
+   auto period = get_period(N(proj1), 202642);
+   BOOST_REQUIRE(!!period);
+   BOOST_REQUIRE(period->root == root);
+   BOOST_REQUIRE_EQUAL(period->entries, 5);
+   BOOST_REQUIRE_EQUAL(period->seconds, 13260);
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[0].pending, 4260);
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[1].pending, 9000);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->pending, 13260);
+
+   // Every entry can be proven by its user
+   for( uint32_t i = entries.size() - 1; i > 0; --i ) {
+      BOOST_REQUIRE_EQUAL( success()
+         , dispute(N(proj1), 202642, entries[i].user, entries[i], i, merkle_proof(levels, i)));
+   }
+   BOOST_REQUIRE_EQUAL(get_period(N(proj1), 202642)->disputes, 4);
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("only the user of the entry or a project manager can dispute")
+      , dispute(N(proj1), 202642, N(user2), entries[0], 0, merkle_proof(levels, 0)));
+   BOOST_REQUIRE_EQUAL( success()
+      , setsink(ME));
+   BOOST_REQUIRE_EQUAL( success()
+      , dispute(N(proj1), 202642, N(mgr1), entries[0], 0, merkle_proof(levels, 0)));
+   auto events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(dispute));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, entries[0].user);
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, 0);
+   BOOST_REQUIRE_EQUAL(events[0].first.amount, 202642);
+
+   // An entry is counted once
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already disputed")
+      , dispute(N(proj1), 202642, entries[0].user, entries[0], 0, merkle_proof(levels, 0)));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already disputed")
+      , dispute(N(proj1), 202642, N(mgr1), entries[3], 3, merkle_proof(levels, 3)));
+   auto pc = get_period(N(proj1), 202642);
+   BOOST_REQUIRE_EQUAL(pc->disputes, 5);
+   BOOST_REQUIRE(pc->disputed == vector<uint32_t>({ 0, 1, 2, 3, 4 }));
+
+   auto changed = entries[0];
+   changed.description = "design and review";
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry not in period")
+      , dispute(N(proj1), 202642, N(user1), changed, 0, merkle_proof(levels, 0)));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry not in period")
+      , dispute(N(proj1), 202642, N(user1), entries[0], 2, merkle_proof(levels, 0)));
+
+   auto proof = merkle_proof(levels, 1);
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry index out of range")
+      , dispute(N(proj1), 202642, N(user2), entries[1], 5, proof));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("period not committed")
+      , dispute(N(proj1), 202643, N(user2), entries[1], 1, proof));
+
+   proof.pop_back();
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("proof too short")
+      , dispute(N(proj1), 202642, N(user2), entries[1], 1, proof));
+   proof = merkle_proof(levels, 1);
+   proof.push_back(root);
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("proof too long")
+      , dispute(N(proj1), 202642, N(user2), entries[1], 1, proof));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( time_entry_ledger, horuspay_snapshot_tester ) try {
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user2)));
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "proj1" );
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 3600, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 1800, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtimes(N(proj1), N(own1), {{N(user1), 600, {}}, {N(user2), 60, {}}}));
+
+   auto clocked_in = control->pending_block_time();
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user1)));
+   produce_blocks(4);
+   BOOST_REQUIRE_EQUAL( success()
+      , clockout(N(proj1), N(user1), {}));
+
+   // One row per entry, a clocked session starts at its clockin
+   auto entries = get_ledger_entries(N(proj1));
+   BOOST_REQUIRE_EQUAL(entries.size(), 5);
+   vector<std::pair<account_name, uint64_t>> expected = {
+      {N(user1), 3600}, {N(user2), 1800}, {N(user1), 600}, {N(user2), 60}, {N(user1), 2}
+   };
+   for( uint32_t i = 0; i < entries.size(); ++i ) {
+      BOOST_REQUIRE_EQUAL(entries[i].id, i);
+      BOOST_REQUIRE_EQUAL(entries[i].user, expected[i].first);
+      BOOST_REQUIRE_EQUAL(entries[i].seconds, expected[i].second);
+      BOOST_REQUIRE_EQUAL(entries[i].status, 0);
+   }
+   BOOST_REQUIRE(entries[4].start.to_time_point() == clocked_in);
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("only managers can approve hours")
+      , approveentry(N(proj1), N(user1), {0}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry not found")
+      , approveentry(N(proj1), N(own1), {99}));
+
+   // 4200s @ 10.0000 USD/h
+   BOOST_REQUIRE_EQUAL( success()
+      , approveentry(N(proj1), N(own1), {0, 2}));
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[0].pending, 2);
+   BOOST_REQUIRE_EQUAL(get_internal_balance(N(user1), symbol{4,"USD"}), asset::from_string("11.6666 USD"));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already settled")
+      , approveentry(N(proj1), N(own1), {2}));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , declineentry(N(proj1), N(own1), {3}));
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[1].pending, 1800);
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already settled")
+      , declineentry(N(proj1), N(own1), {0}));
+
+   entries = get_ledger_entries(N(proj1));
+   BOOST_REQUIRE_EQUAL(entries[0].status, 1);
+   BOOST_REQUIRE_EQUAL(entries[2].status, 1);
+   BOOST_REQUIRE_EQUAL(entries[3].status, 2);
+   BOOST_REQUIRE_EQUAL(get_project_stats(N(proj1))->pending, 1802);
+
+   // Nothing is a day old yet
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 1, 100));
+   BOOST_REQUIRE_EQUAL(get_ledger_entries(N(proj1)).size(), 5);
+   BOOST_REQUIRE(get_rollups(N(proj1)).empty());
+
+   // Settled entries are folded, pending ones stay
+   const uint32_t period = (entries[0].start.to_time_point().sec_since_epoch() + 3 * 86400) / (7 * 86400);
+
+   // Pending entries are not visited, so the older pending entry 1 doesn't use up max_rows
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 0, 1));
+   entries = get_ledger_entries(N(proj1));
+   BOOST_REQUIRE_EQUAL(entries.size(), 4);
+   BOOST_REQUIRE_EQUAL(entries[0].id, 1);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 0, 100));
+
+   entries = get_ledger_entries(N(proj1));
+   BOOST_REQUIRE_EQUAL(entries.size(), 2);
+   BOOST_REQUIRE_EQUAL(entries[0].id, 1);
+   BOOST_REQUIRE_EQUAL(entries[1].id, 4);
+
+   auto rollups = get_rollups(N(proj1));
+   BOOST_REQUIRE_EQUAL(rollups.size(), 2);
+   BOOST_REQUIRE_EQUAL(rollups[0].user, N(user1));
+   BOOST_REQUIRE_EQUAL(rollups[0].period, period);
+   BOOST_REQUIRE_EQUAL(rollups[0].approved, 4200);
+   BOOST_REQUIRE_EQUAL(rollups[0].declined, 0);
+   BOOST_REQUIRE_EQUAL(rollups[0].entries, 2);
+   BOOST_REQUIRE_EQUAL(rollups[1].user, N(user2));
+   BOOST_REQUIRE_EQUAL(rollups[1].declined, 60);
+   BOOST_REQUIRE_EQUAL(rollups[1].entries, 1);
+
+   // max_rows bounds one call, rows are merged into the existing rollups
+   BOOST_REQUIRE_EQUAL( success()
+      , approveentry(N(proj1), N(own1), {1, 4}));
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 0, 1));
+   BOOST_REQUIRE_EQUAL(get_ledger_entries(N(proj1)).size(), 1);
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 0, 10));
+   BOOST_REQUIRE(get_ledger_entries(N(proj1)).empty());
+
+   rollups = get_rollups(N(proj1));
+   BOOST_REQUIRE_EQUAL(rollups.size(), 2);
+   BOOST_REQUIRE_EQUAL(rollups[0].approved, 4202);
+   BOOST_REQUIRE_EQUAL(rollups[0].entries, 3);
+   BOOST_REQUIRE_EQUAL(rollups[1].approved, 1800);
+   BOOST_REQUIRE_EQUAL(rollups[1].declined, 60);
+   BOOST_REQUIRE_EQUAL(rollups[1].entries, 2);
+
+   // Ids are not reused once the ledger is empty
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 60, {}, {}));
+   BOOST_REQUIRE_EQUAL(get_ledger_entries(N(proj1))[0].id, 5);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( rollup_weeks_start_on_monday, horuspay_snapshot_tester ) try {
+
+   const uint32_t week = 7 * 86400;
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "proj1" );
+   produce_block();
+
+   // Monday 00:00 UTC at least a week ahead (1970-01-05 was the first Monday after the epoch)
+   const uint32_t now    = control->pending_block_time().sec_since_epoch();
+   const uint32_t monday = ((now - 4 * 86400) / week + 2) * week + 4 * 86400;
+
+   // One entry on the Sunday before, one on the Monday
+   produce_block( fc::seconds(monday - 1 - now) );
+   BOOST_REQUIRE( control->pending_block_time().sec_since_epoch() < monday );
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 60, {}, {}));
+   produce_blocks(2);
+   BOOST_REQUIRE( control->pending_block_time().sec_since_epoch() >= monday );
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 120, {}, {}));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(own1), N(user1), {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 0, 10));
+
+   auto rollups = get_rollups(N(proj1));
+   BOOST_REQUIRE_EQUAL(rollups.size(), 2);
+   BOOST_REQUIRE_EQUAL(rollups[0].approved, 60);
+   BOOST_REQUIRE_EQUAL(rollups[1].approved, 120);
+   BOOST_REQUIRE_EQUAL(rollups[1].period, rollups[0].period + 1);
+
+   // Periods count weeks from Monday 1969-12-29, three days before the epoch
+   BOOST_REQUIRE_EQUAL(int64_t(rollups[1].period) * week - 3 * 86400, monday);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( counter_approvals_settle_entries, horuspay_snapshot_tester ) try {
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user2)));
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "proj1" );
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 3600, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 1800, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 600, {}, {}));
+
+   // Approved hours can't be paid again through their entry
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(own1), N(user1), 3600));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already settled")
+      , approveentry(N(proj1), N(own1), {0}));
+   BOOST_REQUIRE_EQUAL(get_internal_balance(N(user1), symbol{4,"USD"}), asset::from_string("10.0000 USD"));
+
+   // Part of an entry is split off, the rest stays pending under its id
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(own1), N(user1), 600));
+   BOOST_REQUIRE_EQUAL( success()
+      , decline(N(proj1), N(own1), N(user2), 600));
+
+   auto entries = get_ledger_entries(N(proj1));
+   BOOST_REQUIRE_EQUAL(entries.size(), 4);
+   BOOST_REQUIRE_EQUAL(entries[0].status, 1);
+   BOOST_REQUIRE_EQUAL(entries[1].seconds, 1200);
+   BOOST_REQUIRE_EQUAL(entries[1].status, 0);
+   BOOST_REQUIRE_EQUAL(entries[2].status, 2);
+   BOOST_REQUIRE_EQUAL(entries[3].user, N(user1));
+   BOOST_REQUIRE_EQUAL(entries[3].seconds, 600);
+   BOOST_REQUIRE_EQUAL(entries[3].status, 1);
+   BOOST_REQUIRE(entries[3].start == entries[1].start);
+
+   // 5400s @ 10.0000 USD/h in all
+   BOOST_REQUIRE_EQUAL( success()
+      , approveentry(N(proj1), N(own1), {1}));
+   BOOST_REQUIRE_EQUAL(get_project_users(N(proj1))[0].pending, 0);
+   BOOST_REQUIRE_EQUAL(get_internal_balance(N(user1), symbol{4,"USD"}), asset::from_string("15.0000 USD"));
+
+   // runpayroll and batchapprove settle entries the same way
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user2), 300, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , runpayroll(N(proj1), N(own1), 10));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 60, {}, {}));
+   BOOST_REQUIRE_EQUAL( success()
+      , batchapprove(N(proj1), N(own1), {{N(user1), {}}}));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already settled")
+      , approveentry(N(proj1), N(own1), {4}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("entry already settled")
+      , declineentry(N(proj1), N(own1), {5}));
+   for( const auto& e : get_ledger_entries(N(proj1)) ) {
+      BOOST_REQUIRE(e.status != 0);
+   }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( batched_calls, horuspay_light_tester ) try {
+
+   create_account_with_resources(N(user1), system_account_name);
+   create_account_with_resources(N(user2), system_account_name);
+   create_account_with_resources(N(own1), system_account_name);
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+
+   auto head = control->head_block_num();
+
+   // Calls are only queued until flush
+   begin_batch();
+   BOOST_REQUIRE_EQUAL( success(), adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success(), adduser(N(proj1), N(own1), N(user2)));
+   BOOST_REQUIRE_EQUAL( success(), addtime(N(proj1), N(user1), 60, {}, {}));
+   BOOST_REQUIRE_EQUAL( success(), addtime(N(proj1), N(user1), 60, {}, {}));
+   BOOST_REQUIRE(!get_project_user(N(proj1), N(user1)));
+
+   auto results = flush();
+   BOOST_REQUIRE_EQUAL( results.size(), 4 );
+   for( const auto& r : results ) {
+      BOOST_REQUIRE_EQUAL( success(), r );
+   }
+   BOOST_REQUIRE_EQUAL( control->head_block_num(), head + 1 );
+   BOOST_REQUIRE_EQUAL( get_project_user(N(proj1), N(user1))->pending, 120 );
+
+   // A failing call is reported on its own and the others still apply
+   begin_batch();
+   addtime(N(proj1), N(user2), 30, {}, {});
+   adduser(N(proj1), N(own1), N(user1));
+   addtime(N(proj1), N(user2), 30, {}, {});
+
+   results = flush();
+   BOOST_REQUIRE_EQUAL( results.size(), 3 );
+   BOOST_REQUIRE_EQUAL( success(), results[0] );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("the user is already a member of the project"), results[1] );
+   BOOST_REQUIRE_EQUAL( success(), results[2] );
+   BOOST_REQUIRE_EQUAL( get_project_user(N(proj1), N(user2))->pending, 60 );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( negative_payments_refused, horuspay_light_tester ) try {
+
+   create_account_with_resources(N(user1), system_account_name);
+   create_account_with_resources(N(own1), system_account_name);
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+   issue(name("own1"), asset::from_string("1000.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 3600, {}, {}));
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "proj1" );
+
+   // A negative rate stored before rates were checked must not raise the project balance
+   auto pu = *get_project_user(N(proj1), N(user1));
+   pu.rate = -100000;
+   erase_row(N(proj1), N(projectuser), pu.user.value);
+   store_row(N(proj1), N(projectuser), pu.user.value, pu);
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("payment must not be negative")
+      , approve(N(proj1), N(own1), N(user1), 1800));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("payment must not be negative")
+      , batchapprove(N(proj1), N(own1), {{N(user1), {}}}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("payment must not be negative")
+      , approveentry(N(proj1), N(own1), {0}));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("payment must not be negative")
+      , runpayroll(N(proj1), N(own1), 10));
+
+   BOOST_REQUIRE_EQUAL(get_project(N(proj1))->balance.quantity, asset::from_string("100.0000 USD"));
+   BOOST_REQUIRE_EQUAL(get_project_user(N(proj1), N(user1))->pending, 3600);
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( event_sink, horuspay_light_tester ) try {
+
+   create_account_with_resources(N(own1), system_account_name);
+   create_account_with_resources(N(user1), system_account_name);
+   create_account_with_resources(N(indexer), system_account_name);
+   create_account_with_resources(N(mgr1), system_account_name);
+
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+   issue(name("own1"), asset::from_string("1000.0000 USD"));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), extended_asset(asset::from_string("10.0000 USD"), N(eosio.token))));
+
+   // No sink configured: no events
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE(last_events().empty());
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("sink must be a registered account")
+      , setsink(N(nobody)));
+   BOOST_REQUIRE_EQUAL( success()
+      , setsink(N(indexer)));
+
+   // Project changes without a user row log the owner or manager
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj2), N(own1), extended_asset(asset::from_string("20.0000 USD"), N(eosio.token))));
+   auto events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(create));
+   BOOST_REQUIRE_EQUAL(events[0].first.project, N(proj2));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, N(own1));
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, 0);
+   BOOST_REQUIRE_EQUAL(events[0].first.amount, 200000);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addmanager(N(proj1), N(own1), N(mgr1)));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(addmanager));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, N(mgr1));
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, 0);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , rmvmanager(N(proj1), N(own1), N(mgr1)));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(rmvmanager));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, N(mgr1));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 3600, {}, {}));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(addtime));
+   BOOST_REQUIRE_EQUAL(events[0].first.project, N(proj1));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, N(user1));
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, 3600);
+   BOOST_REQUIRE_EQUAL(events[0].first.amount, 0);
+   BOOST_REQUIRE_EQUAL(events[0].first.pending, 3600);
+   BOOST_REQUIRE_EQUAL(events[0].second.size(), 2);
+   BOOST_REQUIRE_EQUAL(events[0].second[1], N(indexer));
+
+   transfer_with_memo( name("own1"), ME, asset::from_string("100.0000 USD"), "proj1" );
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(deposit));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, N(own1));
+   BOOST_REQUIRE_EQUAL(events[0].first.amount, 1000000);
+   produce_block();
+
+   // 1800s @ 10.0000 USD/h
+   BOOST_REQUIRE_EQUAL( success()
+      , approve(N(proj1), N(own1), N(user1), 1800));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(approve));
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, -1800);
+   BOOST_REQUIRE_EQUAL(events[0].first.amount, 50000);
+   BOOST_REQUIRE_EQUAL(events[0].first.pending, 1800);
+   produce_block();
+
+   // amount is the number of settled entries folded
+   BOOST_REQUIRE_EQUAL( success()
+      , compact(N(proj1), N(own1), 0, 10));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(compact));
+   BOOST_REQUIRE_EQUAL(events[0].first.user, N(own1));
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, 0);
+   BOOST_REQUIRE_EQUAL(events[0].first.amount, 1);
+
+   // clockout carries the session length that last_clock loses
+   BOOST_REQUIRE_EQUAL( success()
+      , clockin(N(proj1), N(user1)));
+   produce_blocks(4);
+   BOOST_REQUIRE_EQUAL( success()
+      , clockout(N(proj1), N(user1), {}));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.event, N(clockout));
+   BOOST_REQUIRE(events[0].first.seconds > 0);
+   BOOST_REQUIRE_EQUAL(events[0].first.pending, 1800 + events[0].first.seconds);
+   auto pending = events[0].first.pending;
+
+   // One event per user row of a batch
+   BOOST_REQUIRE_EQUAL( success()
+      , addtimes(N(proj1), N(own1), {{N(user1), 60, {}}, {N(user1), 30, {}}}));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, 90);
+   BOOST_REQUIRE_EQUAL(events[0].first.pending, pending + 90);
+
+   // The contract itself as sink logs in the traces without notifying anyone
+   BOOST_REQUIRE_EQUAL( success()
+      , setsink(ME));
+   BOOST_REQUIRE_EQUAL( success()
+      , decline(N(proj1), N(own1), N(user1), 90));
+   events = last_events();
+   BOOST_REQUIRE_EQUAL(events.size(), 1);
+   BOOST_REQUIRE_EQUAL(events[0].first.seconds, -90);
+   BOOST_REQUIRE_EQUAL(events[0].first.pending, pending);
+   BOOST_REQUIRE_EQUAL(events[0].second.size(), 1);
+
+   BOOST_REQUIRE_EQUAL( success()
+      , setsink(account_name()));
+   BOOST_REQUIRE_EQUAL( success()
+      , withdraw(N(user1), asset::from_string("5.0000 USD")));
+   BOOST_REQUIRE(last_events().empty());
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( migrate_legacy_rows, horuspay_light_tester ) try {
+
+   for( auto account : { N(own1), N(mgr1), N(user1), N(user2) } ) {
+      create_account_with_resources(account, system_account_name);
+   }
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+
+   const auto rate = extended_asset(asset::from_string("20.0000 USD"), N(eosio.token));
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to migrate")
+      , migrate(10));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), rate));
+
+   // Rows left in scope horuspay by the layout before per-project scopes, and before the token allowlist
+   erase_row(ME, N(tokens), N(eosio.token));
+   erase_row(ME, N(symbols), symbol(4, "USD").to_symbol_code().value);
+   auto clock = block_timestamp_type(control->head_block_time());
+   store_row(ME, N(projectmgr), 0, legacy_project_manager{ 0, N(proj1), N(mgr1), false });
+   store_row(ME, N(projectuser), 0, legacy_project_user{ 0, N(proj1), N(user1), 3600, rate, block_timestamp_type() });
+   store_row(ME, N(projectuser), 1, legacy_project_user{ 1, N(proj1), N(user2), 0,
+                                                         extended_asset(asset::from_string("10.0000 USD"), N(eosio.token)), clock });
+
+   BOOST_REQUIRE_EQUAL( error("missing authority of horuspay")
+      , call(N(own1), horuspay_actions::migrate{ 10 }));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("max_rows must be positive")
+      , migrate(0));
+
+   // Managers go first, then members, max_rows at a time
+   BOOST_REQUIRE_EQUAL( success()
+      , migrate(2));
+   BOOST_REQUIRE_EQUAL( get_project_managers(N(proj1)).size(), 2 );
+   BOOST_REQUIRE_EQUAL( get_project_users(N(proj1)).size(), 1 );
+   BOOST_REQUIRE(!get_project_stats(N(proj1)));
+
+   BOOST_REQUIRE_EQUAL( success()
+      , migrate(2));
+   BOOST_REQUIRE( get_scope_rows<legacy_project_user>(ME, N(projectuser), "legacy_project_user").empty() );
+   BOOST_REQUIRE( get_scope_rows<legacy_project_manager>(ME, N(projectmgr), "legacy_project_manager").empty() );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to migrate")
+      , migrate(10));
+
+   // The project token is allowed again
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("token contract already allowed")
+      , addtoken(N(eosio.token)));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("token contract is used by a project")
+      , rmvtoken(N(eosio.token)));
+
+   auto mgr = get_project_managers(N(proj1));
+   BOOST_REQUIRE_EQUAL( mgr[0].manager, N(mgr1) );
+   BOOST_REQUIRE_EQUAL( mgr[0].is_owner, false );
+
+   auto u1 = get_project_user(N(proj1), N(user1));
+   BOOST_REQUIRE(!!u1);
+   BOOST_REQUIRE_EQUAL( u1->pending, 3600 );
+   BOOST_REQUIRE_EQUAL( u1->rate, 200000 );
+   BOOST_REQUIRE_EQUAL( u1->carry, 0 );
+
+   auto u2 = get_project_user(N(proj1), N(user2));
+   BOOST_REQUIRE(!!u2);
+   BOOST_REQUIRE_EQUAL( u2->rate, 100000 );
+   BOOST_REQUIRE( u2->last_clock == clock );
+
+   // Migrated rows are usable by the current actions, and the stats are counted again
+   BOOST_REQUIRE_EQUAL( success()
+      , addtime(N(proj1), N(user1), 1800, {}, {}));
+
+   auto stats = get_project_stats(N(proj1));
+   BOOST_REQUIRE(!!stats);
+   BOOST_REQUIRE_EQUAL(stats->members, 2);
+   BOOST_REQUIRE_EQUAL(stats->managers, 2);
+   BOOST_REQUIRE_EQUAL(stats->clocked_in, 1);
+   BOOST_REQUIRE_EQUAL(stats->pending, 5400);
+   BOOST_REQUIRE_EQUAL(stats->liability, asset::from_string("30.0000 USD"));
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( typed_actions_match_abi, horuspay_light_tester ) try {
+
+   using namespace horuspay_actions;
+
+   const auto rate = extended_asset(asset::from_string("10.0000 USD"), N(eosio.token));
+
+   // Typed packing must produce the same bytes as the ABI for every action
+   auto check_action = [&]( const auto& data ) {
+      auto action_name = std::decay_t<decltype(data)>::get_name();
+      auto abi_bytes   = horuspay_abi.variant_to_binary( horuspay_abi.get_action_type(action_name), fc::variant(data), abi_serializer_max_time );
+      BOOST_TEST_CONTEXT( action_name.to_string() ) {
+         BOOST_REQUIRE( fc::raw::pack(data) == abi_bytes );
+      }
+   };
+
+   check_action( create{ N(proj1), N(own1), rate } );
+   check_action( addtoken{ N(eosio.token) } );
+   check_action( rmvtoken{ N(eosio.token) } );
+   check_action( adduser{ N(proj1), N(own1), N(user1) } );
+   check_action( removeuser{ N(proj1), N(own1), N(user1) } );
+   check_action( addmanager{ N(proj1), N(own1), N(mgr1) } );
+   check_action( rmvmanager{ N(proj1), N(own1), N(mgr1) } );
+   check_action( clockin{ N(proj1), N(user1) } );
+   check_action( clockout{ N(proj1), N(user1), string("done") } );
+   check_action( clockout{ N(proj1), N(user1), {} } );
+   check_action( switchclock{ N(proj1), N(proj2), N(user1), string("moving") } );
+   check_action( addtime{ N(proj1), N(user1), 3600, string("monday"), N(mgr1) } );
+   check_action( addtime{ N(proj1), N(user1), 3600, {}, {} } );
+   check_action( addtimes{ N(proj1), N(mgr1), { {N(user1), 60, string("a")}, {N(user2), 30, {}} } } );
+   check_action( approve{ N(proj1), N(mgr1), N(user1), 1800 } );
+   check_action( approve{ N(proj1), N(mgr1), N(user1), {} } );
+   check_action( batchapprove{ N(proj1), N(mgr1), { {N(user1), 60}, {N(user2), {}} } } );
+   check_action( runpayroll{ N(proj1), N(mgr1), 100 } );
+   check_action( withdraw{ N(user1), asset::from_string("1.0000 USD") } );
+   check_action( decline{ N(proj1), N(mgr1), N(user1), 600 } );
+   check_action( setuserrate{ N(proj1), N(mgr1), N(user1), rate } );
+   check_action( setkey{ N(user1), get_public_key(N(user1), "active") } );
+   check_action( addsigned{ N(proj1), N(mgr1), { sign_timesheet({N(proj1), N(user1), 3600, 1, 1}),
+                                                 sign_timesheet({N(proj1), N(user2), 600, 1, 2}) } } );
+   const auto root = fc::sha256::hash(string("period"));
+   check_action( commitperiod{ N(proj1), N(mgr1), 7, root, 2, { {N(user1), 3600}, {N(user2), 600} } } );
+   check_action( dispute{ N(proj1), 7, N(user1), { N(user1), 3600, "monday" }, 1, { root, fc::sha256() } } );
+   check_action( approveentry{ N(proj1), N(mgr1), { 0, 2, 5 } } );
+   check_action( declineentry{ N(proj1), N(mgr1), { 3 } } );
+   check_action( setsink{ N(indexer) } );
+   check_action( logevent{ N(addtime), N(proj1), N(user1), 3600, 0, 3600 } );
+   check_action( compact{ N(proj1), N(mgr1), 30, 200 } );
+   check_action( migrate{ 100 } );
+
+   // The ABI path still drives the contract end to end
+   create_account_with_resources(N(user1), system_account_name);
+   create_account_with_resources(N(own1), system_account_name);
+   create_currency(name("eosio.token"), system_account_name, asset::from_string("100000.0000 USD"));
+
+   use_abi = true;
+
+   BOOST_REQUIRE_EQUAL( success()
+      , create(N(proj1), N(own1), rate));
+   BOOST_REQUIRE_EQUAL( success()
+      , adduser(N(proj1), N(own1), N(user1)));
+   BOOST_REQUIRE_EQUAL( success()
+      , addtimes(N(proj1), N(own1), {{N(user1), 60, string("abi")}}));
+
+   auto prjusr = get_project_user(N(proj1), N(user1));
+   BOOST_REQUIRE(!!prjusr);
+   BOOST_REQUIRE_EQUAL(prjusr->pending, 60);
+
+   use_abi = false;
+   BOOST_REQUIRE_EQUAL(get_project_user(N(proj1), N(user1))->pending, 60);
 
 } FC_LOG_AND_RETHROW()
 